@@ -0,0 +1,235 @@
+/** 
+ * @file arena.h
+ * @brief Lock-free single-producer/single-consumer arena for
+ * variable-size records
+ *
+ * Records are stored at their actual size, one after another, in a
+ * region allocated once. One thread may reserve and commit records while
+ * another thread reads and drops them.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 1, 2020
+ */
+
+
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "ringbuffer.h"
+
+
+/** 
+ * @brief alignment of records in byte
+ */
+#define ARENA_ALIGNMENT		4
+
+
+/** 
+ * @brief flag in record header marking unused space at the end of the region
+ */
+#define ARENA_PADDING		0x80000000UL
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+
+
+/**
+ * @brief class MessageArena with fixed memory budget
+ */
+class MessageArena {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param budget memory budget in byte, rounded down to a power of 2.
+	 */
+	MessageArena(uint32_t budget): head(0), tail(0), cachedHead(0), cachedTail(0) {
+		this->capacity = ARENA_ALIGNMENT;
+
+		while (this->capacity * 2 <= budget) {
+			this->capacity *= 2;
+		}
+
+		this->memory = new uint32_t[this->capacity / sizeof(uint32_t)];
+		this->reservedAt = 0;
+		this->reservedSize = 0;
+		this->frontSize = 0;
+	}
+
+
+	/**
+	 * @brief Destructor
+	 */
+	~MessageArena() {
+		delete[] this->memory;
+	}
+
+
+	/**
+	 * @brief Reserve space for a new record, called by the producer only
+	 *
+	 * The record becomes visible to the consumer after commit(). Reserving
+	 * again without commit() discards the previous reservation.
+	 * @param size size of the record in byte.
+	 * @return pointer to the record, NULL: not enough space.
+	 */
+	uint8_t* reserve(uint32_t size) {
+		uint32_t t = this->tail.load(std::memory_order_relaxed);
+		uint32_t index = t & (this->capacity - 1);
+		uint32_t total = align(sizeof(uint32_t) + size);
+		uint32_t needed = total;
+
+		// a record never wraps around the end of the region
+		if (index + total > this->capacity) {
+			needed += this->capacity - index;
+		}
+
+		if (needed > this->capacity - (t - this->cachedHead)) {
+			this->cachedHead = this->head.load(std::memory_order_acquire);
+
+			if (needed > this->capacity - (t - this->cachedHead)) {
+				return NULL;
+			}
+		}
+
+		if (needed != total) {
+			word(index) = ARENA_PADDING | (this->capacity - index);
+			t += this->capacity - index;
+		}
+
+		this->reservedAt = t;
+		this->reservedSize = total;
+		this->reservedSpan = needed;
+
+		return (uint8_t*)&word((t & (this->capacity - 1)) + sizeof(uint32_t));
+	}
+
+
+	/**
+	 * @brief Publish the record returned by reserve(), called by the producer only
+	 * @return bytes taken by the record, including alignment and padding.
+	 */
+	uint32_t commit() {
+		word(this->reservedAt & (this->capacity - 1)) = this->reservedSize;
+		this->tail.store(this->reservedAt + this->reservedSize, std::memory_order_release);
+
+		return this->reservedSpan;
+	}
+
+
+	/**
+	 * @brief Get the oldest record without removing it, called by the consumer only
+	 * @param size size of the record in byte, including alignment.
+	 * @return pointer to the record, NULL: arena is empty.
+	 */
+	uint8_t* front(uint32_t &size) {
+		uint32_t h = this->head.load(std::memory_order_relaxed);
+
+		while (1) {
+			if (h == this->cachedTail) {
+				this->cachedTail = this->tail.load(std::memory_order_acquire);
+
+				if (h == this->cachedTail) {
+					return NULL;
+				}
+			}
+
+			uint32_t header = word(h & (this->capacity - 1));
+
+			if ((header & ARENA_PADDING) == 0) {
+				this->frontSize = header;
+				size = header - sizeof(uint32_t);
+
+				return (uint8_t*)&word((h & (this->capacity - 1)) + sizeof(uint32_t));
+			}
+
+			// skip the unused end of the region
+			h += header & ~ARENA_PADDING;
+			this->head.store(h, std::memory_order_release);
+		}
+	}
+
+
+	/**
+	 * @brief Release the record returned by front(), called by the consumer only
+	 * @return nothing.
+	 */
+	void drop() {
+		this->head.store(this->head.load(std::memory_order_relaxed) + this->frontSize, 
+							std::memory_order_release);
+	}
+
+
+	/**
+	 * @brief Check if the arena is empty
+	 * @return true/false.
+	 */
+	bool empty() const {
+		return this->head.load(std::memory_order_acquire) 
+				== this->tail.load(std::memory_order_acquire);
+	}
+
+
+	/**
+	 * @brief Get the number of bytes in use
+	 * @return the number of bytes.
+	 */
+	uint32_t size() const {
+		return this->tail.load(std::memory_order_acquire) 
+				- this->head.load(std::memory_order_acquire);
+	}
+
+
+	/**
+	 * @brief Get the size of the region
+	 * @return the size in byte.
+	 */
+	uint32_t getCapacity() const {
+		return this->capacity;
+	}
+
+
+private:
+
+	static uint32_t align(uint32_t size) {
+		return (size + ARENA_ALIGNMENT - 1) & ~(uint32_t)(ARENA_ALIGNMENT - 1);
+	}
+
+	uint32_t& word(uint32_t offset) {
+		return this->memory[offset / sizeof(uint32_t)];
+	}
+
+	/** 
+	 * @brief position of the oldest record, written by the consumer
+	 */
+	std::atomic<uint32_t> head;
+	uint8_t headPadding[RINGBUFFER_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+
+	/** 
+	 * @brief position after the newest record, written by the producer
+	 */
+	std::atomic<uint32_t> tail;
+	uint8_t tailPadding[RINGBUFFER_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+
+	uint32_t cachedHead; /**< producer's copy of head */
+	uint32_t reservedAt; /**< position of the reserved record */
+	uint32_t reservedSize; /**< size of the reserved record */
+	uint32_t reservedSpan; /**< size of the reserved record and padding */
+	uint8_t producerPadding[RINGBUFFER_CACHE_LINE - 4 * sizeof(uint32_t)];
+
+	uint32_t cachedTail; /**< consumer's copy of tail */
+	uint32_t frontSize; /**< size of the record returned by front() */
+	uint8_t consumerPadding[RINGBUFFER_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+	uint32_t capacity; /**< size of the region, a power of 2 */
+	uint32_t *memory; /**< the region */
+};
+
+} /* namespace eLinux */
+
+#endif /* __ARENA__ */
@@ -0,0 +1,288 @@
+/**
+ * @file awaitable.h
+ * @brief Classes for waiting on messages in C++20 coroutines
+ *
+ * Waiting coroutines are kept in a list and resumed by a Reactor when
+ * messages arrive, when a send completes or when a timeout expires. No
+ * thread is blocked per waiting coroutine, so any number of them can
+ * share one event loop. Available when the compiler supports coroutines,
+ * e.g. with -std=c++20.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 13, 2020
+ */
+
+
+#ifndef __AWAITABLE__
+#define __AWAITABLE__
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <pthread.h>
+#include "message.h"
+#include "reactor.h"
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+template <MESSAGE_TRANSPORT T> class AwaitableBox;
+
+
+/**
+ * @brief Awaiter of a message, co_await gives 0: received, -1: timeout
+ */
+template <MESSAGE_TRANSPORT T>
+class ReceiveAwaiter {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param owner the AwaitableBox;
+	 * @param message destination of the message;
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 */
+	ReceiveAwaiter(AwaitableBox<T> &owner, Message_t *message, int timeout);
+
+	bool await_ready() { return false; }
+
+	bool await_suspend(std::coroutine_handle<> handle);
+
+	int await_resume() { return this->result; }
+
+
+protected:
+
+	friend class AwaitableBox<T>;
+
+	AwaitableBox<T> &owner; /**< the AwaitableBox */
+	Message_t *message; /**< destination of the message */
+	int timeout; /**< maximum waiting time in milliseconds, -1: forever */
+	int result; /**< 0: received, -1: timeout */
+	uint64_t deadline; /**< time of the timeout in ns, 0: none */
+	std::coroutine_handle<> handle; /**< the waiting coroutine */
+	ReceiveAwaiter<T> *previous; /**< previous waiter in the list */
+	ReceiveAwaiter<T> *next; /**< next waiter in the list */
+};
+
+
+/**
+ * @brief Awaiter of a message, co_await gives the message
+ */
+template <MESSAGE_TRANSPORT T>
+class MessageAwaiter : public ReceiveAwaiter<T> {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param owner the AwaitableBox.
+	 */
+	MessageAwaiter(AwaitableBox<T> &owner): ReceiveAwaiter<T>(owner, &this->storage, -1) {}
+
+	/**
+	 * @brief Copy constructor, the copy receives into its own storage
+	 */
+	MessageAwaiter(const MessageAwaiter<T> &other): ReceiveAwaiter<T>(other.owner, &this->storage, -1) {}
+
+	Message_t await_resume() { return this->storage; }
+
+
+private:
+
+	Message_t storage; /**< the message */
+};
+
+
+/**
+ * @brief Awaiter of an asynchronous send, co_await gives 0: sent, -1: failed
+ */
+template <MESSAGE_TRANSPORT T>
+class SendAwaiter {
+public:
+
+	/**
+	 * @brief Constructor, the message is copied when the coroutine suspends
+	 */
+	SendAwaiter(AwaitableBox<T> &owner,
+				const void* preamble,
+				uint8_t destination,
+				uint8_t source,
+				const void* payload,
+				uint32_t len,
+				priority_t priority);
+
+	bool await_ready() { return false; }
+
+	bool await_suspend(std::coroutine_handle<> handle);
+
+	int await_resume() { return this->result; }
+
+
+private:
+
+	friend class AwaitableBox<T>;
+
+	/**
+	 * @brief Completion function of sendAsync(), runs in the transmit thread
+	 * @param result 0: sent, -1: failed.
+	 * @param arg pointer to SendAwaiter.
+	 * @return nothing.
+	 */
+	static void completed(int result, void *arg);
+
+	AwaitableBox<T> &owner; /**< the AwaitableBox */
+	const void* preamble; /**< preamble of the packet */
+	uint8_t destination; /**< receiver's address */
+	uint8_t source; /**< transmitter's address */
+	const void* payload; /**< message */
+	uint32_t len; /**< length of message */
+	priority_t priority; /**< priority class of the packet */
+	int result; /**< 0: sent, -1: failed */
+	std::coroutine_handle<> handle; /**< the waiting coroutine */
+	SendAwaiter<T> *next; /**< next completed send */
+};
+
+
+/**
+ * @brief class AwaitableBox used for receiving and sending messages
+ * in coroutines
+ *
+ * Coroutines are resumed in the thread of the Reactor, outside of its
+ * lock and of the lock of this class, so a resumed coroutine may destroy
+ * the AwaitableBox or the MessageBox. It must not be destroyed while
+ * coroutines are waiting.
+ */
+template <MESSAGE_TRANSPORT T>
+class AwaitableBox {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param box Message Box delivering and sending the messages;
+	 * @param reactor event loop resuming the coroutines, it must run.
+	 */
+	AwaitableBox(MessageBox<T>& box, BBB::Reactor& reactor);
+
+	/**
+	 * @brief Destructor
+	 */
+	~AwaitableBox();
+
+
+	/**
+	 * @brief Wait for the oldest message
+	 *
+	 * Waiting coroutines get messages in the order they started to wait.
+	 * @return awaiter, co_await gives the message.
+	 */
+	MessageAwaiter<T> receive();
+
+
+	/**
+	 * @brief Wait for the oldest message with a timeout
+	 * @param message destination of the message;
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return awaiter, co_await gives 0: received, -1: timeout.
+	 */
+	ReceiveAwaiter<T> receive(Message_t &message, int timeout=-1);
+
+
+	/**
+	 * @brief Send message packet, resuming when it is sent
+	 *
+	 * The packet goes through MessageBox::sendAsync().
+	 * @param [in] preamble preamble of the packet.
+	 * @param [in] destination Receiver's address.
+	 * @param [in] source Transmitter's address.
+	 * @param [in] payload message need to be sent, valid until resumed.
+	 * @param [in] len length of message.
+	 * @param [in] priority priority class of the packet.
+	 * @return awaiter, co_await gives 0: sent, -1: failed.
+	 */
+	SendAwaiter<T> send(const void* preamble,
+						uint8_t destination,
+						uint8_t source,
+						const void* payload,
+						uint32_t len,
+						priority_t priority=kPriorityNormal);
+
+
+private:
+
+	friend class ReceiveAwaiter<T>;
+	friend class SendAwaiter<T>;
+
+	/**
+	 * @brief Take a message, or add the waiter to the list
+	 * @param waiter the waiter.
+	 * @return true: the coroutine waits, false: it goes on.
+	 */
+	bool wait(ReceiveAwaiter<T> *waiter);
+
+	/**
+	 * @brief Remove a waiter from the list, lock is held
+	 * @param waiter the waiter.
+	 * @return nothing.
+	 */
+	void unlink(ReceiveAwaiter<T> *waiter);
+
+	/**
+	 * @brief Set the timer to a deadline, lock is held
+	 * @param deadline time in ns, 0: stop the timer.
+	 * @return nothing.
+	 */
+	void arm(uint64_t deadline);
+
+	/**
+	 * @brief Queue a completed send for the Reactor
+	 * @param sender the completed send.
+	 * @return nothing.
+	 */
+	void complete(SendAwaiter<T> *sender);
+
+	/**
+	 * @brief Hand messages to waiting coroutines, called by the Reactor
+	 * @param arg pointer to AwaitableBox.
+	 * @return nothing.
+	 */
+	static void onMessage(void *arg);
+
+	/**
+	 * @brief Resume the coroutines whose timeout expired, called by the Reactor
+	 * @param arg pointer to AwaitableBox.
+	 * @return nothing.
+	 */
+	static void onTimer(void *arg);
+
+	/**
+	 * @brief Resume the coroutines whose send completed, called by the Reactor
+	 * @param arg pointer to AwaitableBox.
+	 * @return nothing.
+	 */
+	static void onCompletion(void *arg);
+
+	MessageBox<T>& box; /**< Message Box */
+	BBB::Reactor& reactor; /**< event loop */
+
+	pthread_mutex_t lock; /**< protects the lists and the timer */
+	ReceiveAwaiter<T> *first; /**< oldest waiting receiver */
+	ReceiveAwaiter<T> *last; /**< newest waiting receiver */
+	SendAwaiter<T> *completedFirst; /**< oldest completed send */
+	SendAwaiter<T> *completedLast; /**< newest completed send */
+
+	int timerfd; /**< timerfd of the earliest timeout */
+	uint64_t armed; /**< deadline of timerfd in ns, 0: stopped */
+	int wakeupfd; /**< eventfd signalling completed sends */
+};
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#include "awaitable_impl.h"
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* __AWAITABLE__ */
@@ -0,0 +1,397 @@
+/**
+ * @file awaitable_impl.h
+ * @brief Implementations for waiting on messages in C++20 coroutines
+ *
+ * It is included by awaitable.h, so AwaitableBox works with any transport.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 13, 2020
+ */
+
+#ifndef __AWAITABLE_IMPL__
+#define __AWAITABLE_IMPL__
+
+#include "awaitable.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+template <MESSAGE_TRANSPORT T>
+ReceiveAwaiter<T>::ReceiveAwaiter(AwaitableBox<T> &_owner, Message_t *message, int timeout):
+	owner{_owner}
+{
+	this->message = message;
+	this->timeout = timeout;
+	this->result = -1;
+	this->deadline = 0;
+	this->previous = NULL;
+	this->next = NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+bool ReceiveAwaiter<T>::await_suspend(std::coroutine_handle<> handle) {
+	this->handle = handle;
+
+	return this->owner.wait(this);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+SendAwaiter<T>::SendAwaiter(AwaitableBox<T> &_owner,
+							const void* preamble,
+							uint8_t destination,
+							uint8_t source,
+							const void* payload,
+							uint32_t len,
+							priority_t priority):
+	owner{_owner}
+{
+	this->preamble = preamble;
+	this->destination = destination;
+	this->source = source;
+	this->payload = payload;
+	this->len = len;
+	this->priority = priority;
+	this->result = -1;
+	this->next = NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+bool SendAwaiter<T>::await_suspend(std::coroutine_handle<> handle) {
+	this->handle = handle;
+
+	// the coroutine may be resumed before this returns,
+	// the awaiter is not touched after a successful call
+	if (this->owner.box.sendAsync(this->preamble, this->destination, this->source,
+									this->payload, this->len, completed, this,
+									this->priority) < 0)
+	{
+		this->result = -1;
+		return false;
+	}
+
+	return true;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void SendAwaiter<T>::completed(int result, void *arg) {
+	SendAwaiter<T> *sender = (SendAwaiter<T>*)arg;
+
+	sender->result = result;
+	sender->owner.complete(sender);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+AwaitableBox<T>::AwaitableBox(MessageBox<T>& _box, BBB::Reactor& _reactor):
+	box{_box},
+	reactor{_reactor}
+{
+	pthread_mutex_init(&this->lock, NULL);
+
+	this->first = NULL;
+	this->last = NULL;
+	this->completedFirst = NULL;
+	this->completedLast = NULL;
+	this->armed = 0;
+
+	if ((this->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0) {
+		perror("AwaitableBox: Failed to create timerfd");
+	}
+
+	if ((this->wakeupfd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		perror("AwaitableBox: Failed to create eventfd");
+	}
+
+	// the eventfd of Message Box stays readable while messages wait,
+	// only new messages are of interest
+	this->reactor.add(this->box.getEventFd(), onMessage, this, EPOLLIN | EPOLLET);
+	this->reactor.add(this->timerfd, onTimer, this);
+	this->reactor.add(this->wakeupfd, onCompletion, this);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+AwaitableBox<T>::~AwaitableBox() {
+	this->reactor.remove(this->box.getEventFd());
+	this->reactor.remove(this->timerfd);
+	this->reactor.remove(this->wakeupfd);
+
+	::close(this->timerfd);
+	::close(this->wakeupfd);
+
+	pthread_mutex_destroy(&this->lock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+MessageAwaiter<T> AwaitableBox<T>::receive() {
+	return MessageAwaiter<T>(*this);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+ReceiveAwaiter<T> AwaitableBox<T>::receive(Message_t &message, int timeout) {
+	return ReceiveAwaiter<T>(*this, &message, timeout);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+SendAwaiter<T> AwaitableBox<T>::send(const void* preamble,
+									uint8_t destination,
+									uint8_t source,
+									const void* payload,
+									uint32_t len,
+									priority_t priority)
+{
+	return SendAwaiter<T>(*this, preamble, destination, source, payload, len, priority);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+bool AwaitableBox<T>::wait(ReceiveAwaiter<T> *waiter) {
+	pthread_mutex_lock(&this->lock);
+
+	// a message is taken at once only if nobody waits before
+	if (this->first == NULL && this->box.pop(*waiter->message) == 0) {
+		pthread_mutex_unlock(&this->lock);
+		waiter->result = 0;
+		return false;
+	}
+
+	if (waiter->timeout == 0) {
+		pthread_mutex_unlock(&this->lock);
+		waiter->result = -1;
+		return false;
+	}
+
+	waiter->result = -1;
+	waiter->deadline = 0;
+
+	if (waiter->timeout > 0) {
+		waiter->deadline = monotonicTime() + (uint64_t)waiter->timeout * 1000000;
+
+		if (this->armed == 0 || waiter->deadline < this->armed) {
+			arm(waiter->deadline);
+		}
+	}
+
+	waiter->previous = this->last;
+	waiter->next = NULL;
+
+	if (this->last) {
+		this->last->next = waiter;
+	}
+	else {
+		this->first = waiter;
+	}
+
+	this->last = waiter;
+
+	pthread_mutex_unlock(&this->lock);
+
+	return true;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::unlink(ReceiveAwaiter<T> *waiter) {
+	if (waiter->previous) {
+		waiter->previous->next = waiter->next;
+	}
+	else {
+		this->first = waiter->next;
+	}
+
+	if (waiter->next) {
+		waiter->next->previous = waiter->previous;
+	}
+	else {
+		this->last = waiter->previous;
+	}
+
+	waiter->previous = NULL;
+	waiter->next = NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::arm(uint64_t deadline) {
+	struct itimerspec spec;
+
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = 0;
+	spec.it_value.tv_sec = deadline / 1000000000ULL;
+	spec.it_value.tv_nsec = deadline % 1000000000ULL;
+
+	if (timerfd_settime(this->timerfd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+		perror("AwaitableBox: Failed to set timer");
+	}
+
+	this->armed = deadline;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::complete(SendAwaiter<T> *sender) {
+	uint64_t value = 1;
+
+	pthread_mutex_lock(&this->lock);
+
+	sender->next = NULL;
+
+	if (this->completedLast) {
+		this->completedLast->next = sender;
+	}
+	else {
+		this->completedFirst = sender;
+	}
+
+	this->completedLast = sender;
+
+	pthread_mutex_unlock(&this->lock);
+
+	if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+		perror("AwaitableBox: Failed to wake up event loop");
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::onMessage(void *arg) {
+	AwaitableBox<T> *owner = (AwaitableBox<T>*)arg;
+	ReceiveAwaiter<T> *served = NULL;
+	ReceiveAwaiter<T> *servedLast = NULL;
+
+	pthread_mutex_lock(&owner->lock);
+
+	// messages left over are taken by the next wait(), nobody waits anymore
+	while (owner->first && owner->box.pop(*owner->first->message) == 0) {
+		ReceiveAwaiter<T> *waiter = owner->first;
+
+		owner->unlink(waiter);
+		waiter->result = 0;
+
+		// served waiters are chained in order through next
+		if (servedLast) {
+			servedLast->next = waiter;
+		}
+		else {
+			served = waiter;
+		}
+
+		servedLast = waiter;
+	}
+
+	pthread_mutex_unlock(&owner->lock);
+
+	// a resumed coroutine may destroy the AwaitableBox, owner is not used
+	while (served) {
+		ReceiveAwaiter<T> *waiter = served;
+
+		served = served->next;
+		waiter->handle.resume();
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::onTimer(void *arg) {
+	AwaitableBox<T> *owner = (AwaitableBox<T>*)arg;
+	ReceiveAwaiter<T> *expired = NULL;
+	ReceiveAwaiter<T> *expiredLast = NULL;
+	uint64_t next = 0;
+	uint64_t value;
+
+	if (::read(owner->timerfd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		perror("AwaitableBox: Failed to read timer");
+	}
+
+	pthread_mutex_lock(&owner->lock);
+
+	uint64_t now = monotonicTime();
+	ReceiveAwaiter<T> *waiter = owner->first;
+
+	while (waiter) {
+		ReceiveAwaiter<T> *following = waiter->next;
+
+		if (waiter->deadline && waiter->deadline <= now) {
+			owner->unlink(waiter);
+
+			// expired waiters are chained in order through next
+			if (expiredLast) {
+				expiredLast->next = waiter;
+			}
+			else {
+				expired = waiter;
+			}
+
+			expiredLast = waiter;
+		}
+		else if (waiter->deadline && (next == 0 || waiter->deadline < next)) {
+			next = waiter->deadline;
+		}
+
+		waiter = following;
+	}
+
+	owner->arm(next);
+
+	pthread_mutex_unlock(&owner->lock);
+
+	while (expired) {
+		waiter = expired;
+		expired = expired->next;
+
+		waiter->result = -1;
+		waiter->handle.resume();
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void AwaitableBox<T>::onCompletion(void *arg) {
+	AwaitableBox<T> *owner = (AwaitableBox<T>*)arg;
+	uint64_t value;
+
+	if (::read(owner->wakeupfd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		perror("AwaitableBox: Failed to read eventfd");
+	}
+
+	pthread_mutex_lock(&owner->lock);
+
+	SendAwaiter<T> *sender = owner->completedFirst;
+
+	owner->completedFirst = NULL;
+	owner->completedLast = NULL;
+
+	pthread_mutex_unlock(&owner->lock);
+
+	while (sender) {
+		SendAwaiter<T> *following = sender->next;
+
+		sender->handle.resume();
+		sender = following;
+	}
+}
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* __AWAITABLE_IMPL__ */
\ No newline at end of file
@@ -41,6 +41,31 @@ crc32_t crc32_compute(const void* data, uint32_t len);
 crc32_t crc32_concat(crc32_t checksum, const void* data, uint32_t len);
 
 
+/** 
+ * @brief copy a data array and extend a CRC-32 checksum value over it
+ * in the same pass.
+ * @param checksum existing checksum value.
+ * @param dst destination array.
+ * @param src source array.
+ * @param len the length of data in byte.
+ * @return CRC-32 checksum value.
+ */
+crc32_t crc32_copy(crc32_t checksum, void* dst, const void* src, uint32_t len);
+
+
+/** 
+ * @brief combine CRC-32 checksum values of 2 consecutive data arrays.
+ *
+ * The second array is not needed, so separately computed checksums
+ * can be merged in O(log lenB).
+ * @param checksumA checksum value of the first array.
+ * @param checksumB checksum value of the second array.
+ * @param lenB the length of the second array in byte.
+ * @return CRC-32 checksum value of both arrays.
+ */
+crc32_t crc32_combine(crc32_t checksumA, crc32_t checksumB, uint32_t lenB);
+
+
 /** 
  * @brief check the accuracy of computed CRC-32 checksum value.
  * @param data pointer to an array;
@@ -0,0 +1,220 @@
+/**
+ * @file dispatcher.h
+ * @brief Class for dispatching received messages to handlers per
+ * source address
+ *
+ * Messages are taken from MessageBox by a feeder thread and handled by
+ * a pool of worker threads. Messages of one source are handled one at
+ * a time, in order of arrival. Each source has its own bounded queue,
+ * so a slow source never holds back or drops messages of another.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 3, 2020
+ */
+
+
+#ifndef __DISPATCHER__
+#define __DISPATCHER__
+
+#include <pthread.h>
+#include "message.h"
+
+
+/**
+ * @brief default number of messages waiting for each source
+ */
+#ifndef DISPATCHER_QUEUE_SIZE
+#define DISPATCHER_QUEUE_SIZE	16
+#endif
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+/**
+ * @brief pointer type for message handler
+ */
+typedef void (*HandlerType)(const MessageView_t &message, void *arg);
+
+
+/**
+ * @brief class Dispatcher used for handling messages in a worker pool
+ */
+template <MESSAGE_TRANSPORT T>
+class Dispatcher {
+public:
+
+	/**
+	 * @brief Constructor
+	 *
+	 * Each source address belongs to one worker. With work stealing, an
+	 * idle worker also takes messages of sources belonging to busy workers.
+	 * @param box Message Box delivering the messages;
+	 * @param workers number of worker threads;
+	 * @param stealing enable work stealing;
+	 * @param depth number of messages waiting for each source.
+	 */
+	Dispatcher(MessageBox<T>& box,
+				uint8_t workers=1,
+				bool stealing=false,
+				uint32_t depth=DISPATCHER_QUEUE_SIZE);
+
+	/**
+	 * @brief Destructor, stops all threads
+	 */
+	~Dispatcher();
+
+
+	/**
+	 * @brief Register handler for messages from one source
+	 * @param source source address.
+	 * @param handler handler function, NULL: use the default handler.
+	 * @param arg argument of handler function.
+	 * @return nothing.
+	 */
+	void onMessage(uint8_t source, HandlerType handler, void *arg);
+
+
+	/**
+	 * @brief Register handler for sources without their own handler
+	 * @param handler handler function, NULL: drop those messages.
+	 * @param arg argument of handler function.
+	 * @return nothing.
+	 */
+	void onDefault(HandlerType handler, void *arg);
+
+
+	/**
+	 * @brief Start the feeder and worker threads
+	 * @return 0: OK, -1: Error.
+	 */
+	int start();
+
+
+	/**
+	 * @brief Stop all threads, waiting for running handlers
+	 *
+	 * Messages still queued in the workers are dropped.
+	 * @return nothing.
+	 */
+	void stop();
+
+
+	/**
+	 * @brief Get the number of messages dropped because a source queue was full
+	 * @return the number of messages.
+	 */
+	uint32_t getDropped();
+
+
+	/**
+	 * @brief Get the number of dropped messages of one source
+	 * @param source source address.
+	 * @return the number of messages.
+	 */
+	uint32_t getDropped(uint8_t source);
+
+
+private:
+
+	/**
+	 * @brief Struct containing a registered handler
+	 */
+	struct Handler_t {
+		HandlerType handler; /**< @brief handler function */
+		void *arg; /**< @brief argument of handler function */
+	};
+
+	/**
+	 * @brief Struct containing the queue of one source address
+	 */
+	struct Source_t {
+		Message_t *queue; /**< @brief ring of waiting messages, allocated on first use */
+		uint32_t head; /**< @brief index of the oldest message */
+		uint32_t count; /**< @brief number of waiting messages */
+		uint32_t dropped; /**< @brief messages dropped on the full queue */
+		bool busy; /**< @brief a message of the source is being handled */
+		bool listed; /**< @brief the source is in the ready list of its worker */
+		Source_t *next; /**< @brief next source in the ready list */
+	};
+
+	/**
+	 * @brief Struct containing state of one worker
+	 */
+	struct Worker_t {
+		Dispatcher<T> *owner; /**< @brief dispatcher of the worker */
+		pthread_t thread; /**< @brief thread ID */
+		pthread_cond_t ready; /**< @brief signalled when the worker may have work */
+		bool waiting; /**< @brief worker is waiting for work */
+		Source_t *first; /**< @brief oldest source with a message to handle */
+		Source_t *last; /**< @brief newest source with a message to handle */
+		Message_t current; /**< @brief message being handled */
+	};
+
+	/**
+	 * @brief Move available messages from Message Box to the workers
+	 * @return nothing.
+	 */
+	void feed();
+
+	/**
+	 * @brief Handle messages until the dispatcher stops
+	 * @param worker state of the calling worker.
+	 * @return nothing.
+	 */
+	void work(Worker_t *worker);
+
+	/**
+	 * @brief Find a source whose oldest message may be handled now
+	 * @param worker the calling worker.
+	 * @return the source, removed from its ready list, NULL: nothing to do.
+	 */
+	Source_t* pick(Worker_t *worker);
+
+	/**
+	 * @brief Add a source with waiting messages to the ready list of its worker,
+	 * unless it is listed or busy
+	 * @param address source address.
+	 * @return nothing.
+	 */
+	void ready(uint8_t address);
+
+	/**
+	 * @brief Wake up workers which may have work now
+	 * @param worker the worker owning the new work.
+	 * @return nothing.
+	 */
+	void wake(Worker_t *worker);
+
+	static void* feederThread(void *arg);
+	static void* workerThread(void *arg);
+
+	MessageBox<T>& box; /**< Message Box delivering the messages */
+
+	uint8_t workerCount; /**< number of workers */
+	bool stealing; /**< work stealing enabled */
+	uint32_t depth; /**< capacity of each source queue */
+	Worker_t *workers; /**< worker states */
+
+	Handler_t handlers[256]; /**< handlers per source address */
+	Handler_t defaultHandler; /**< handler for other sources */
+	Source_t sources[256]; /**< queues per source address */
+
+	pthread_mutex_t lock; /**< protects handlers, queues and ready lists */
+	bool running; /**< threads are running */
+	bool stopping; /**< threads are asked to stop */
+	uint32_t dropped; /**< messages dropped on full queues */
+
+	int wakeupfd; /**< eventfd used to stop the feeder */
+	pthread_t feeder; /**< feeder thread ID */
+};
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#include "dispatcher_impl.h"
+
+#endif /* __DISPATCHER__ */
@@ -0,0 +1,438 @@
+/**
+ * @file dispatcher_impl.h
+ * @brief Implementations for dispatching received messages to handlers
+ * per source address
+ *
+ * It is included by dispatcher.h, so Dispatcher works with any transport.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 3, 2020
+ */
+
+#ifndef __DISPATCHER_IMPL__
+#define __DISPATCHER_IMPL__
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "dispatcher.h"
+
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+template <MESSAGE_TRANSPORT T>
+Dispatcher<T>::Dispatcher(MessageBox<T>& _box,
+						uint8_t workers,
+						bool stealing,
+						uint32_t depth): box{_box} {
+
+	this->workerCount = workers ? workers : 1;
+	this->stealing = stealing;
+	this->depth = depth ? depth : 1;
+	this->running = false;
+	this->stopping = false;
+	this->dropped = 0;
+
+	this->defaultHandler.handler = NULL;
+	this->defaultHandler.arg = NULL;
+
+	for (int i = 0; i < 256; i++) {
+		this->handlers[i] = this->defaultHandler;
+		this->sources[i].queue = NULL;
+		this->sources[i].head = 0;
+		this->sources[i].count = 0;
+		this->sources[i].dropped = 0;
+		this->sources[i].busy = false;
+		this->sources[i].listed = false;
+		this->sources[i].next = NULL;
+	}
+
+	pthread_mutex_init(&this->lock, NULL);
+
+	if ((this->wakeupfd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		perror("Dispatcher: Failed to create eventfd");
+	}
+
+	this->workers = new Worker_t[this->workerCount];
+
+	for (uint8_t i = 0; i < this->workerCount; i++) {
+		Worker_t *worker = &this->workers[i];
+
+		worker->owner = this;
+		worker->waiting = false;
+		worker->first = NULL;
+		worker->last = NULL;
+		pthread_cond_init(&worker->ready, NULL);
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+Dispatcher<T>::~Dispatcher() {
+	stop();
+
+	for (uint8_t i = 0; i < this->workerCount; i++) {
+		pthread_cond_destroy(&this->workers[i].ready);
+	}
+
+	for (int i = 0; i < 256; i++) {
+		delete[] this->sources[i].queue;
+	}
+
+	delete[] this->workers;
+	::close(this->wakeupfd);
+	pthread_mutex_destroy(&this->lock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::onMessage(uint8_t source, HandlerType handler, void *arg) {
+	pthread_mutex_lock(&this->lock);
+
+	this->handlers[source].handler = handler;
+	this->handlers[source].arg = arg;
+
+	pthread_mutex_unlock(&this->lock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::onDefault(HandlerType handler, void *arg) {
+	pthread_mutex_lock(&this->lock);
+
+	this->defaultHandler.handler = handler;
+	this->defaultHandler.arg = arg;
+
+	pthread_mutex_unlock(&this->lock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int Dispatcher<T>::start() {
+	if (this->running) {
+		return 0;
+	}
+
+	this->stopping = false;
+
+	uint8_t started = 0;
+
+	for (; started < this->workerCount; started++) {
+		if (pthread_create(&this->workers[started].thread, NULL,
+							workerThread, &this->workers[started]) != 0) {
+			perror("Dispatcher: Failed to create worker thread");
+			break;
+		}
+	}
+
+	if (started == this->workerCount
+		&& pthread_create(&this->feeder, NULL, feederThread, this) == 0) {
+		this->running = true;
+		return 0;
+	}
+
+	if (started == this->workerCount) {
+		perror("Dispatcher: Failed to create feeder thread");
+	}
+
+	// undo a partial start
+	pthread_mutex_lock(&this->lock);
+	this->stopping = true;
+
+	for (uint8_t i = 0; i < started; i++) {
+		pthread_cond_signal(&this->workers[i].ready);
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	for (uint8_t i = 0; i < started; i++) {
+		pthread_join(this->workers[i].thread, NULL);
+	}
+
+	return -1;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::stop() {
+	if (!this->running) {
+		return;
+	}
+
+	uint64_t value = 1;
+
+	pthread_mutex_lock(&this->lock);
+	this->stopping = true;
+
+	for (uint8_t i = 0; i < this->workerCount; i++) {
+		pthread_cond_signal(&this->workers[i].ready);
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+		perror("Dispatcher: Failed to wake up feeder");
+	}
+
+	pthread_join(this->feeder, NULL);
+
+	for (uint8_t i = 0; i < this->workerCount; i++) {
+		pthread_join(this->workers[i].thread, NULL);
+	}
+
+	if (::read(this->wakeupfd, &value, sizeof(value)) < 0) {
+		perror("Dispatcher: Failed to reset eventfd");
+	}
+
+	// drop what was not handled
+	for (uint8_t i = 0; i < this->workerCount; i++) {
+		this->workers[i].first = NULL;
+		this->workers[i].last = NULL;
+	}
+
+	for (int i = 0; i < 256; i++) {
+		this->sources[i].count = 0;
+		this->sources[i].listed = false;
+		this->sources[i].next = NULL;
+	}
+
+	this->running = false;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t Dispatcher<T>::getDropped() {
+	pthread_mutex_lock(&this->lock);
+	uint32_t n = this->dropped;
+	pthread_mutex_unlock(&this->lock);
+
+	return n;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t Dispatcher<T>::getDropped(uint8_t source) {
+	pthread_mutex_lock(&this->lock);
+	uint32_t n = this->sources[source].dropped;
+	pthread_mutex_unlock(&this->lock);
+
+	return n;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::feed() {
+	MessageView_t message;
+
+	while (this->box.peek(message) == 0) {
+		Source_t *source = &this->sources[message.address];
+
+		pthread_mutex_lock(&this->lock);
+
+		if (source->queue == NULL) {
+			source->queue = new Message_t[this->depth];
+		}
+
+		// only a source filling its own queue loses messages
+		if (source->count == this->depth) {
+			source->dropped++;
+			this->dropped++;
+		}
+		else {
+			Message_t *slot = &source->queue[(source->head + source->count) % this->depth];
+
+			slot->address = message.address;
+			slot->payloadSize = message.payloadSize;
+			memcpy(slot->payload, message.payload, message.payloadSize);
+			source->count++;
+
+			ready(message.address);
+		}
+
+		pthread_mutex_unlock(&this->lock);
+
+		this->box.consume();
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::work(Worker_t *worker) {
+	pthread_mutex_lock(&this->lock);
+
+	while (!this->stopping) {
+		Source_t *source = pick(worker);
+
+		if (source == NULL) {
+			worker->waiting = true;
+			pthread_cond_wait(&worker->ready, &this->lock);
+			worker->waiting = false;
+			continue;
+		}
+
+		Message_t *message = &source->queue[source->head];
+		uint8_t address = message->address;
+
+		worker->current.address = address;
+		worker->current.payloadSize = message->payloadSize;
+		memcpy(worker->current.payload, message->payload, message->payloadSize);
+
+		source->head = (source->head + 1) % this->depth;
+		source->count--;
+
+		Handler_t handler = this->handlers[address];
+
+		if (handler.handler == NULL) {
+			handler = this->defaultHandler;
+		}
+
+		source->busy = true;
+		pthread_mutex_unlock(&this->lock);
+
+		if (handler.handler) {
+			MessageView_t view;
+
+			view.address = worker->current.address;
+			view.payloadSize = worker->current.payloadSize;
+			view.payload = worker->current.payload;
+
+			handler.handler(view, handler.arg);
+		}
+
+		pthread_mutex_lock(&this->lock);
+		source->busy = false;
+
+		// the next message of this source queues behind the other sources
+		ready(address);
+	}
+
+	pthread_mutex_unlock(&this->lock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+typename Dispatcher<T>::Source_t* Dispatcher<T>::pick(Worker_t *worker) {
+	Worker_t *victim = worker;
+
+	// listed sources are never busy, so the order of a source is kept
+	if (victim->first == NULL) {
+		if (!this->stealing) {
+			return NULL;
+		}
+
+		for (uint8_t i = 0; i < this->workerCount && victim->first == NULL; i++) {
+			victim = &this->workers[i];
+		}
+
+		if (victim->first == NULL) {
+			return NULL;
+		}
+	}
+
+	Source_t *source = victim->first;
+
+	victim->first = source->next;
+
+	if (victim->first == NULL) {
+		victim->last = NULL;
+	}
+
+	source->listed = false;
+	source->next = NULL;
+
+	return source;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::ready(uint8_t address) {
+	Source_t *source = &this->sources[address];
+
+	if (source->count == 0 || source->busy || source->listed) {
+		return;
+	}
+
+	Worker_t *worker = &this->workers[address % this->workerCount];
+
+	// sources with waiting messages take turns
+	if (worker->last) {
+		worker->last->next = source;
+	}
+	else {
+		worker->first = source;
+	}
+
+	worker->last = source;
+	source->listed = true;
+
+	wake(worker);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void Dispatcher<T>::wake(Worker_t *worker) {
+	if (!worker->waiting && this->stealing) {
+		for (uint8_t i = 0; i < this->workerCount; i++) {
+			if (this->workers[i].waiting) {
+				worker = &this->workers[i];
+				break;
+			}
+		}
+	}
+
+	// a signalled worker no longer counts as waiting
+	if (worker->waiting) {
+		worker->waiting = false;
+		pthread_cond_signal(&worker->ready);
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void* Dispatcher<T>::feederThread(void *arg) {
+	Dispatcher<T> *dispatcher = static_cast<Dispatcher<T>*>(arg);
+	struct pollfd fds[2];
+
+	fds[0].fd = dispatcher->box.getEventFd();
+	fds[0].events = POLLIN;
+	fds[1].fd = dispatcher->wakeupfd;
+	fds[1].events = POLLIN;
+
+	while (1) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("Dispatcher: Failed to poll");
+			break;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			break;
+		}
+
+		dispatcher->feed();
+	}
+
+	return NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void* Dispatcher<T>::workerThread(void *arg) {
+	Worker_t *worker = static_cast<Worker_t*>(arg);
+
+	worker->owner->work(worker);
+
+	return NULL;
+}
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#endif /* __DISPATCHER_IMPL__ */
\ No newline at end of file
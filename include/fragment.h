@@ -0,0 +1,168 @@
+/** 
+ * @file fragment.h
+ * @brief Class for fragmentation and reassembly of large messages
+ *  
+ * Messages larger than one frame are split into numbered fragments and
+ * sent with MessageBox. The receiving side reassembles them into
+ * preallocated buffers.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 25, 2020
+ */
+
+
+#ifndef __FRAGMENT__
+#define __FRAGMENT__
+
+#include "message.h"
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+/** 
+ * @brief Struct containing fragment header, placed before the data
+ * in the payload of each frame
+ */
+struct FragmentHeader_t {
+	uint8_t id; /**< @brief message number, the same for all fragments */
+	uint16_t index; /**< @brief fragment number, starting from 0 */
+	uint16_t count; /**< @brief number of fragments of the message */
+} __attribute__((packed));
+
+
+/** 
+ * @brief maximum data size of one fragment
+ */
+#define FRAGMENT_DATA_SIZE	(MESSAGE_MAX_PAYLOAD_SIZE - sizeof(FragmentHeader_t))
+
+
+/** 
+ * @brief maximum number of fragments of a message, limited by FragmentHeader_t::count
+ */
+#define FRAGMENT_MAX_COUNT	65535
+
+
+/** 
+ * @brief maximum size of a message in byte
+ */
+#define FRAGMENT_MAX_SIZE	((uint64_t)FRAGMENT_MAX_COUNT * FRAGMENT_DATA_SIZE)
+
+
+/**
+ * @brief class FragmentBox used for transmitting/receiving large messages
+ */
+template <MESSAGE_TRANSPORT T>
+class FragmentBox {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param box Message Box carrying the fragments;
+	 * @param maxSize maximum size of a reassembled message in byte,
+	 * at most FRAGMENT_MAX_SIZE;
+	 * @param slots number of messages reassembled at the same time, at least 1;
+	 * @param perSource maximum number of reassemblies per source address, at least 1;
+	 * @param timeout time in milliseconds before an incomplete message is dropped.
+	 */
+	FragmentBox(MessageBox<T>& box,
+				uint32_t maxSize,
+				uint8_t slots=4,
+				uint8_t perSource=2,
+				uint32_t timeout=1000);
+
+	/**
+	 * @brief Destructor
+	 */
+	~FragmentBox();
+
+
+	/** 
+	 * @brief Send a message of any size up to maxSize
+	 *
+	 * Split the message into fragments and transmit them.
+	 * @param [in] preamble preamble of the packets.
+	 * @param [in] destination Receiver's address.
+	 * @param [in] source Transmitter's address.
+	 * @param [in] data message need to be sent.
+	 * @param [in] len length of message. 
+	 * @return 0: success, -1: failed.
+	 */
+	int send(const void* preamble,
+				uint8_t destination, 
+				uint8_t source, 
+				const void* data, 
+				uint32_t len);
+
+
+	/** 
+	 * @brief Wait for the next complete message
+	 *
+	 * The message stays valid until the next call of receive().
+	 * @param [out] source Transmitter's address.
+	 * @param [out] data pointer to the reassembled message.
+	 * @param [out] len length of message.
+	 * @param [in] timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int receive(uint8_t &source, const uint8_t* &data, uint32_t &len, int timeout);
+
+
+private:
+
+	/** 
+	 * @brief Struct containing state of one reassembly
+	 */
+	struct Reassembly_t {
+		bool active; /**< @brief reassembly in progress */
+		uint8_t source; /**< @brief source address */
+		uint8_t id; /**< @brief message number */
+		uint16_t count; /**< @brief number of fragments */
+		uint16_t received; /**< @brief number of received fragments */
+		uint32_t length; /**< @brief message length, known from the last fragment */
+		uint64_t updated; /**< @brief time of the latest fragment in ns, see monotonicTime() */
+		uint8_t *buffer; /**< @brief preallocated message buffer */
+		uint8_t *bitmap; /**< @brief received fragments */
+	};
+
+	/**
+	 * @brief Add a received fragment to its reassembly
+	 * @param [in] message view of received frame.
+	 * @param [out] source Transmitter's address of the complete message.
+	 * @param [out] data pointer to the complete message.
+	 * @param [out] len length of the complete message.
+	 * @return 0: a message is complete, -1: otherwise.
+	 */
+	int process(MessageView_t &message, uint8_t &source, const uint8_t* &data, uint32_t &len);
+
+	/**
+	 * @brief Find a reassembly slot for a new message
+	 * @param source source address.
+	 * @return pointer to the slot, NULL: no slot.
+	 */
+	Reassembly_t* allocate(uint8_t source);
+
+	MessageBox<T>& box; /**< Message Box carrying the fragments */
+
+	uint32_t maxSize; /**< maximum size of a reassembled message */
+	uint32_t fragmentCount; /**< maximum number of fragments of a message */
+	uint8_t slotCount; /**< number of reassembly slots */
+	uint8_t perSource; /**< maximum number of reassemblies per source */
+	uint64_t timeout; /**< reassembly timeout in nanoseconds */
+
+	Reassembly_t *slots; /**< reassembly slots */
+	Reassembly_t *delivered; /**< slot handed out by the last receive() */
+	bool borrowed; /**< the last receive() handed out a frame of Message Box */
+
+	uint8_t nextId; /**< message number of the next sent message */
+};
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#include "fragment_impl.h"
+
+#endif /* __FRAGMENT__ */
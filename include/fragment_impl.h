@@ -0,0 +1,299 @@
+/** 
+ * @file fragment_impl.h
+ * @brief Implementations for fragmentation and reassembly of large messages
+ *
+ * It is included by fragment.h, so FragmentBox works with any transport.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 25, 2020
+ */
+
+#ifndef __FRAGMENT_IMPL__
+#define __FRAGMENT_IMPL__
+
+#include <string.h>
+#include "fragment.h"
+
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+static_assert(MESSAGE_MAX_PAYLOAD_SIZE > sizeof(FragmentHeader_t), 
+				"payload is too small for fragments");
+
+
+template <MESSAGE_TRANSPORT T>
+FragmentBox<T>::FragmentBox(MessageBox<T>& _box,
+							uint32_t maxSize,
+							uint8_t slots,
+							uint8_t perSource,
+							uint32_t timeout): box{_box} {
+
+	// the fragment count of a message fits in its header, a slot is always there
+	this->maxSize = (maxSize > FRAGMENT_MAX_SIZE) ? FRAGMENT_MAX_SIZE : maxSize;
+	this->slotCount = slots ? slots : 1;
+	this->perSource = perSource ? perSource : 1;
+	this->timeout = (uint64_t)timeout * 1000000ULL;
+	this->nextId = 0;
+	this->delivered = NULL;
+	this->borrowed = false;
+
+	this->fragmentCount = (this->maxSize + FRAGMENT_DATA_SIZE - 1) / FRAGMENT_DATA_SIZE;
+
+	if (this->fragmentCount == 0) {
+		this->fragmentCount = 1;
+	}
+
+	this->slots = new Reassembly_t[this->slotCount];
+
+	for (uint8_t i = 0; i < this->slotCount; i++) {
+		this->slots[i].active = false;
+		this->slots[i].buffer = new uint8_t[this->maxSize];
+		this->slots[i].bitmap = new uint8_t[(this->fragmentCount + 7) / 8];
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+FragmentBox<T>::~FragmentBox() {
+	for (uint8_t i = 0; i < this->slotCount; i++) {
+		delete[] this->slots[i].buffer;
+		delete[] this->slots[i].bitmap;
+	}
+
+	delete[] this->slots;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int FragmentBox<T>::send(const void* preamble,
+						uint8_t destination, 
+						uint8_t source, 
+						const void* _data, 
+						uint32_t len)
+{
+	const uint8_t *data = (const uint8_t*)_data;
+	uint8_t payload[MESSAGE_MAX_PAYLOAD_SIZE];
+	FragmentHeader_t header;
+	uint64_t count = ((uint64_t)len + FRAGMENT_DATA_SIZE - 1) / FRAGMENT_DATA_SIZE;
+
+	// a message is never sent in part
+	if (len > this->maxSize || count > FRAGMENT_MAX_COUNT) {
+		return -1;
+	}
+
+	header.id = this->nextId++;
+	header.index = 0;
+	header.count = count ? count : 1;
+
+	// queue all fragments, MessageBox writes them in batches
+	for (uint32_t offset = 0; header.index < header.count; header.index++) {
+		uint32_t size = len - offset;
+
+		if (size > FRAGMENT_DATA_SIZE) {
+			size = FRAGMENT_DATA_SIZE;
+		}
+
+		memcpy(payload, &header, sizeof(header));
+		memcpy(payload + sizeof(header), data + offset, size);
+		offset += size;
+
+		if (this->box.post(preamble, destination, source, 
+							payload, sizeof(header) + size) < 0) {
+			return -1;
+		}
+	}
+
+	return this->box.flush();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int FragmentBox<T>::receive(uint8_t &source, const uint8_t* &data, uint32_t &len, int timeout) {
+	uint64_t deadline = monotonicTime() + (uint64_t)timeout * 1000000ULL;
+
+	// the previous message is consumed now
+	if (this->delivered) {
+		this->delivered->active = false;
+		this->delivered = NULL;
+	}
+
+	if (this->borrowed) {
+		this->box.consume();
+		this->borrowed = false;
+	}
+
+	while (1) {
+		MessageView_t message;
+		int remaining = -1;
+
+		if (timeout >= 0) {
+			uint64_t now = monotonicTime();
+			remaining = (now < deadline) ? (deadline - now + 999999) / 1000000 : 0;
+		}
+
+		if (this->box.peek(message, remaining) < 0) {
+			return -1;
+		}
+
+		// fragments are copied straight from Message Box into their slot
+		if (process(message, source, data, len) < 0) {
+			this->box.consume();
+		}
+		else if (this->delivered) {
+			this->box.consume();
+			return 0;
+		}
+		else {
+			this->borrowed = true;
+			return 0;
+		}
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int FragmentBox<T>::process(MessageView_t &message, uint8_t &source, const uint8_t* &data, uint32_t &len) {
+	FragmentHeader_t header;
+
+	if (message.payloadSize < sizeof(header)) {
+		return -1;
+	}
+
+	memcpy(&header, message.payload, sizeof(header));
+
+	const uint8_t *fragment = message.payload + sizeof(header);
+	uint32_t size = message.payloadSize - sizeof(header);
+	uint32_t offset = (uint32_t)header.index * FRAGMENT_DATA_SIZE;
+
+	// the header comes from the line, the slot buffers hold fragmentCount fragments
+	if (header.index >= header.count || header.count > this->fragmentCount
+		|| offset + size > (uint32_t)header.count * FRAGMENT_DATA_SIZE
+		|| offset + size > this->maxSize)
+	{
+		return -1;
+	}
+
+	// only the last fragment is short, and only a single fragment is empty,
+	// so the length always agrees with the number of fragments
+	if (header.index < header.count - 1) {
+		if (size != FRAGMENT_DATA_SIZE) {
+			return -1;
+		}
+	}
+	else if (size == 0 && header.count > 1) {
+		return -1;
+	}
+
+	// a message in one fragment is handed out in place
+	if (header.count == 1) {
+		source = message.address;
+		data = fragment;
+		len = size;
+
+		return 0;
+	}
+
+	uint64_t now = monotonicTime();
+	Reassembly_t *slot = NULL;
+
+	for (uint8_t i = 0; i < this->slotCount; i++) {
+		Reassembly_t *s = &this->slots[i];
+
+		if (s->active && now - s->updated > this->timeout) {
+			s->active = false;
+		}
+
+		if (s->active && s->source == message.address && s->id == header.id) {
+			slot = s;
+		}
+	}
+
+	if (slot == NULL) {
+		slot = allocate(message.address);
+
+		if (slot == NULL) {
+			return -1;
+		}
+
+		slot->active = true;
+		slot->source = message.address;
+		slot->id = header.id;
+		slot->count = header.count;
+		slot->received = 0;
+		slot->length = 0;
+		memset(slot->bitmap, 0, (header.count + 7) / 8);
+	}
+
+	uint8_t mask = 1 << (header.index & 7);
+
+	if (header.count != slot->count || (slot->bitmap[header.index / 8] & mask)) {
+		return -1;
+	}
+
+	memcpy(slot->buffer + offset, fragment, size);
+	slot->bitmap[header.index / 8] |= mask;
+	slot->received++;
+	slot->updated = now;
+
+	if (header.index == header.count - 1) {
+		slot->length = offset + size;
+	}
+
+	if (slot->received < slot->count) {
+		return -1;
+	}
+
+	this->delivered = slot;
+
+	source = slot->source;
+	data = slot->buffer;
+	len = slot->length;
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+typename FragmentBox<T>::Reassembly_t* FragmentBox<T>::allocate(uint8_t source) {
+	Reassembly_t *freeSlot = NULL;
+	Reassembly_t *oldest = NULL;
+	Reassembly_t *oldestOfSource = NULL;
+	uint8_t ofSource = 0;
+
+	for (uint8_t i = 0; i < this->slotCount; i++) {
+		Reassembly_t *s = &this->slots[i];
+
+		if (!s->active) {
+			freeSlot = s;
+			continue;
+		}
+
+		if (oldest == NULL || s->updated < oldest->updated) {
+			oldest = s;
+		}
+
+		if (s->source == source) {
+			ofSource++;
+
+			if (oldestOfSource == NULL || s->updated < oldestOfSource->updated) {
+				oldestOfSource = s;
+			}
+		}
+	}
+
+	// a source never holds more than its share of slots
+	if (ofSource >= this->perSource) {
+		return oldestOfSource;
+	}
+
+	if (freeSlot) {
+		return freeSlot;
+	}
+
+	return oldest;
+}
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#endif /* __FRAGMENT_IMPL__ */
\ No newline at end of file
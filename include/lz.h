@@ -0,0 +1,86 @@
+/**
+ * @file lz.h
+ * @brief Function prototypes for a small LZ77 compressor
+ *
+ * The format follows LZ4 sequences: a token with literal and match
+ * lengths, the literals, a 2-byte offset and extra length bytes.
+ * An optional dictionary shared by both sides acts as history before
+ * the data, so short messages compress well.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date 2020 Feb 10
+ */
+
+
+#ifndef __LZ__
+#define __LZ__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+/**
+ * @brief number of bits of the dictionary hash table
+ */
+#define LZ_HASH_BITS		12
+
+
+/**
+ * @brief maximum size of a dictionary in byte
+ */
+#define LZ_MAX_DICTIONARY	32768
+
+
+/**
+ * @brief shared history of compressor and decompressor
+ */
+typedef struct {
+	const uint8_t *data; /**< dictionary content, kept by the caller */
+	uint32_t len; /**< length of content */
+	uint16_t table[1 << LZ_HASH_BITS]; /**< positions + 1 of hashed content */
+} lz_dictionary_t;
+
+
+/**
+ * @brief prepare a dictionary.
+ * @param dictionary the dictionary.
+ * @param data content, must stay valid while the dictionary is used.
+ * @param len length of content, the last LZ_MAX_DICTIONARY byte are used.
+ * @return nothing.
+ */
+void lz_dictionary(lz_dictionary_t *dictionary, const void *data, uint32_t len);
+
+
+/**
+ * @brief compress a byte array.
+ * @param dictionary shared history, or NULL.
+ * @param src data.
+ * @param len length of data.
+ * @param dst output.
+ * @param capacity size of output.
+ * @return length of compressed data, 0: it does not fit into capacity.
+ */
+uint32_t lz_compress(const lz_dictionary_t *dictionary, const void *src, uint32_t len,
+						void *dst, uint32_t capacity);
+
+
+/**
+ * @brief decompress a byte array.
+ * @param dictionary shared history, or NULL.
+ * @param src compressed data.
+ * @param len length of compressed data.
+ * @param dst output.
+ * @param capacity size of output.
+ * @return length of data, -1: corrupted input or output too small.
+ */
+int32_t lz_decompress(const lz_dictionary_t *dictionary, const void *src, uint32_t len,
+						void *dst, uint32_t capacity);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LZ__ */
@@ -14,8 +14,15 @@
 #ifndef __MESSAGE__
 #define __MESSAGE__
 
-#include <queue>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <atomic>
 #include "crc32.h"
+#include "rs.h"
+#include "lz.h"
+#include "arena.h"
+#include "ringbuffer.h"
+#include "transport.h"
 
 /** 
  * @brief massage preamble size
@@ -24,18 +31,182 @@
 
 
 /** 
- * @brief maximum payload size
+ * @brief maximum payload size, up to 65535 byte
+ *
+ * Frame geometry is fixed at compile time, every node of a link must be
+ * built with the same value.
  */		
+#ifndef MESSAGE_MAX_PAYLOAD_SIZE
 #define MESSAGE_MAX_PAYLOAD_SIZE	32
+#endif
+
+
+/** 
+ * @brief size of the payload size field: 1 byte, or 2 byte (little-endian)
+ * for payloads larger than 255 byte
+ */
+#if MESSAGE_MAX_PAYLOAD_SIZE > 0xFFFF
+#error "MESSAGE_MAX_PAYLOAD_SIZE must not exceed 65535"
+#elif MESSAGE_MAX_PAYLOAD_SIZE > 0xFF
+#define MESSAGE_SIZE_FIELD_SIZE		2
+#else
+#define MESSAGE_SIZE_FIELD_SIZE		1
+#endif
+
+
+/** 
+ * @brief version of the frame format
+ *
+ * 1: preamble, address, payload size, payload, checksum.
+ * 2: a control byte follows the address. It is needed for compressed
+ * and coalesced frames, but nodes of version 1 cannot read the frames.
+ * Every node of a link must be built with the same version.
+ */
+#ifndef MESSAGE_PROTOCOL_VERSION
+#define MESSAGE_PROTOCOL_VERSION	1
+#endif
+
+#if MESSAGE_PROTOCOL_VERSION == 1
+#define MESSAGE_CONTROL_SIZE		0
+#elif MESSAGE_PROTOCOL_VERSION == 2
+#define MESSAGE_CONTROL_SIZE		1
+#else
+#error "MESSAGE_PROTOCOL_VERSION must be 1 or 2"
+#endif
+
+
+/** 
+ * @brief size of frame header: preamble, address, control byte and payload size
+ */
+#define MESSAGE_HEADER_SIZE		(MESSAGE_PREAMBLE_SIZE + 2 + MESSAGE_CONTROL_SIZE + MESSAGE_SIZE_FIELD_SIZE)
+
+
+/** 
+ * @brief flags of the control byte in frame header, version 2
+ */
+#define MESSAGE_CONTROL_COMPRESSED	0x01 /**< payload is compressed */
+#define MESSAGE_CONTROL_BATCH		0x02 /**< payload is a sequence of records: size, then message */
+
+
+/** 
+ * @brief maximum frame size: header, payload and CRC-32 checksum
+ */
+#define MESSAGE_MAX_FRAME_SIZE	(MESSAGE_HEADER_SIZE + MESSAGE_MAX_PAYLOAD_SIZE + 4)
+
+
+/** 
+ * @brief maximum number of bytes kept in the kernel output queue
+ *
+ * Enough for two frames, so the line never idles between back-to-back
+ * frames while the queue stays short.
+ */
+#ifndef MESSAGE_TX_QUEUE_LIMIT
+#define MESSAGE_TX_QUEUE_LIMIT		(2 * MESSAGE_MAX_FRAME_SIZE)
+#endif
+
+
+/** 
+ * @brief maximum number of bytes kept in the kernel output queue by frames
+ * below high priority
+ *
+ * A high priority frame waits for no more than this before it is sent.
+ */
+#ifndef MESSAGE_TX_PREEMPT_LIMIT
+#define MESSAGE_TX_PREEMPT_LIMIT	MESSAGE_MAX_FRAME_SIZE
+#endif
+
+
+/** 
+ * @brief maximum number of frames queued per priority class,
+ * and transmitted in one call
+ */
+#ifndef MESSAGE_TX_BATCH_SIZE
+#define MESSAGE_TX_BATCH_SIZE		8
+#endif
+
+
+/** 
+ * @brief maximum number of messages waiting for the transmit thread,
+ * must be a power of 2
+ */
+#ifndef MESSAGE_TX_RING_SIZE
+#define MESSAGE_TX_RING_SIZE		16
+#endif
+
+
+/** 
+ * @brief default memory for received messages in byte,
+ * rounded down to a power of 2
+ */
+#ifndef MESSAGE_FIFO_BUDGET
+#define MESSAGE_FIFO_BUDGET			4096
+#endif
+
+
+/** 
+ * @brief size of the buffer for incoming data
+ */
+#ifndef MESSAGE_RX_CHUNK_SIZE
+#define MESSAGE_RX_CHUNK_SIZE		256
+#endif
+
+
+/*
+ * The values above are part of the frame format and of the class layout.
+ * They must be the same in every translation unit of a program, so set them
+ * for the whole build, e.g. with target_compile_definitions(... PUBLIC ...),
+ * and the same on every node of a link. Values given on the command line
+ * must be integer literals.
+ */
+static_assert(MESSAGE_MAX_PAYLOAD_SIZE > 0, "MESSAGE_MAX_PAYLOAD_SIZE must not be 0");
+static_assert(MESSAGE_TX_BATCH_SIZE > 0, "MESSAGE_TX_BATCH_SIZE must not be 0");
+static_assert(MESSAGE_TX_RING_SIZE > 0 && (MESSAGE_TX_RING_SIZE & (MESSAGE_TX_RING_SIZE - 1)) == 0,
+				"MESSAGE_TX_RING_SIZE must be a power of 2");
+static_assert(MESSAGE_TX_QUEUE_LIMIT >= MESSAGE_TX_PREEMPT_LIMIT,
+				"MESSAGE_TX_QUEUE_LIMIT must not be below MESSAGE_TX_PREEMPT_LIMIT");
+static_assert(MESSAGE_FIFO_BUDGET > 0, "MESSAGE_FIFO_BUDGET must not be 0");
+static_assert(MESSAGE_RX_CHUNK_SIZE > 0, "MESSAGE_RX_CHUNK_SIZE must not be 0");
+
+
+/** 
+ * @brief name of the inline namespace holding the types of this library
+ *
+ * It is made of the values that change the class layout, so translation
+ * units built with different values get different types and symbols:
+ * mixing them fails to compile or link instead of breaking silently.
+ */
+#define MESSAGE_CONFIG		MESSAGE_CONFIG_NAME(MESSAGE_PROTOCOL_VERSION, MESSAGE_MAX_PAYLOAD_SIZE, \
+											MESSAGE_TX_BATCH_SIZE, MESSAGE_TX_RING_SIZE, \
+											MESSAGE_RX_CHUNK_SIZE)
+
+#define MESSAGE_CONFIG_NAME(version, payload, batch, ring, chunk) \
+			MESSAGE_CONFIG_JOIN(version, payload, batch, ring, chunk)
+#define MESSAGE_CONFIG_JOIN(version, payload, batch, ring, chunk) \
+			config_v ## version ## _ ## payload ## _ ## batch ## _ ## ring ## _ ## chunk
 
 
 /**
  * @brief namespace eLinux
  */
 namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+/**
+ * @brief pointer type for completion function of an asynchronous send,
+ * result is 0: sent, -1: failed
+ */
+typedef void (*CompletionType)(int result, void *arg);
 
 
-typedef void (*CallbackType)(void*);
+/**
+ * @brief datatype for payload size
+ */
+#if MESSAGE_SIZE_FIELD_SIZE == 2
+typedef uint16_t message_size_t;
+#else
+typedef uint8_t message_size_t;
+#endif
 
 
 /** 
@@ -43,43 +214,169 @@ typedef void (*CallbackType)(void*);
  */
 struct Message_t {
 	uint8_t address; /**< @brief source address: 1 byte */
-	uint8_t payloadSize; /**< @brief size of payload  */
+	message_size_t payloadSize; /**< @brief size of payload  */
 	uint8_t payload[MESSAGE_MAX_PAYLOAD_SIZE]; /**< @brief array contains payload */
 } __attribute__((packed));
 
 
+/** 
+ * @brief Struct containing read-only view of a received message
+ */
+struct MessageView_t {
+	uint8_t address; /**< @brief source address: 1 byte */
+	message_size_t payloadSize; /**< @brief size of payload  */
+	const uint8_t *payload; /**< @brief pointer to payload in Message Box */
+};
+
+
 /** 
  * @brief Struct containing message frame
  */
 struct MessageFrame_t;
 
 
+/** 
+ * @brief number of priority classes of outgoing frames
+ */
+#define MESSAGE_PRIORITY_LEVELS		3
+
+
+/** 
+ * @brief priority classes of outgoing frames, highest first
+ */
+enum priority_t {kPriorityHigh = 0, /**< control traffic: e-stop, heartbeat,... */
+				kPriorityNormal, /**< default */
+				kPriorityLow /**< bulk data */
+			};
+
+
 /** 
  * @brief enum contains code for each step of transmitting/receiving procedure
  */  
 enum step_t {kParsingPreamble = 0, /**< step 1: parse the preamble */
-			kParsingAddress, /**< step 2: receive destination and source address */
+			kParsingAddress, /**< step 2: receive destination, source address and control byte (version 2) */
 			kParsingSize, /**< step 3: receive payload size */
 			kParsingPayload, /**< step 4: receive payload */
 			kParsingChecksum, /**< step 5: receive CRC-32 checksum */
+			kSkippingFrame, /**< step 5': skip payload and checksum of a frame for another node */
 			kVerifyingChecksum /**< step 6: finish receiving prodedure */
 		}; /**< @brief variable contains current state of procedure */
 
 
+/**
+ * @brief class MessageQueue holding received Messages for one consumer
+ *
+ * Messages are stored in a MessageArena at their actual size. An eventfd
+ * is readable while a Message is available. One thread reserves and
+ * commits Messages, another one peeks, consumes and waits.
+ */
+class MessageQueue {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param budget memory for Messages in byte, allocated once,
+	 * raised so two Messages of maximum size always fit.
+	 */
+	MessageQueue(uint32_t budget);
+
+
+	/**
+	 * @brief Destructor
+	 */
+	~MessageQueue();
+
+
+	/**
+	 * @brief Reserve a Message, called by the producer only
+	 * @param size size of the payload.
+	 * @return pointer to the Message, NULL: the queue is full.
+	 */
+	Message_t* reserve(uint32_t size);
+
+
+	/**
+	 * @brief Publish the reserved Message, called by the producer only
+	 * @return nothing.
+	 */
+	void commit();
+
+
+	/**
+	 * @brief Borrow the oldest Message
+	 * @param view view of the Message.
+	 * @return 0: success, -1: the queue is empty.
+	 */
+	int peek(MessageView_t &view);
+
+
+	/**
+	 * @brief Release the Message borrowed by peek()
+	 * @return nothing.
+	 */
+	void consume();
+
+
+	/**
+	 * @brief Pop the oldest Message
+	 * @param message Message instance.
+	 * @return 0: success, -1: the queue is empty.
+	 */
+	int pop(Message_t &message);
+
+
+	/**
+	 * @brief Wait until a Message is available
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int wait(int timeout);
+
+
+	/**
+	 * @brief Get the file descriptor signalling new Messages
+	 * @return eventfd file descriptor.
+	 */
+	int getEventFd();
+
+
+	/**
+	 * @brief Check if the queue is empty
+	 * @return true/false.
+	 */
+	bool empty();
+
+
+private:
+
+	/**
+	 * @brief Make eventfd readable.
+	 * @return nothing.
+	 */
+	void notify();
+
+	MessageArena arena; /**< Messages at their actual size */
+	int eventfd; /**< readable while arena is not empty */
+};
+
+
 /**
  * @brief class Message used for transmitting/receiving message packet
+ * @tparam T physical layer device, see transport.h.
  */
-template <class T>
+template <MESSAGE_TRANSPORT T>
 class MessageBox {
+	static_assert(Transport<T>::valid, "MessageBox: T does not meet the transport requirements");
+
 public:
 
 	/**
 	 * @brief Constructor
-	 * @param bus UART bus number;
-	 * @param baudrate UART baudrate;
-	 * @param bit data size: 5,6,7 or 8 bit
+	 * @param device physical layer device;
+	 * @param budget memory for received messages in byte, allocated once.
+	 * Messages are stored at their actual size.
 	 */
-	MessageBox(T& device);
+	MessageBox(T& device, uint32_t budget=MESSAGE_FIFO_BUDGET);
 
 	/**
 	 * @brief Destructor
@@ -90,19 +387,97 @@ public:
 	/** 
 	 * @brief Send message packet
 	 *
-	 * Assemble message packet and transmit.
-	 * @param [in] baudrate UART baudrate.
+	 * Assemble message packet and transmit. It returns when the packet
+	 * and all packets of the same or higher priority queued before it
+	 * are sent. If coalescing is enabled, a short message is added to
+	 * the pending batch and sent later.
+	 * @param [in] preamble preamble of the packet.
 	 * @param [in] destination Receiver's address.
 	 * @param [in] source Transmitter's address.
 	 * @param [in] payload message need to be sent.
 	 * @param [in] len length of message. 
-	 * @return nothing.
+	 * @param [in] priority priority class of the packet.
+	 * @return 0: success, -1: failed.
+	 */
+	int send(const void* preamble,
+				uint8_t destination, 
+				uint8_t source, 
+				const void* payload, 
+				uint32_t len,
+				priority_t priority=kPriorityNormal);
+
+
+	/** 
+	 * @brief Send message packet without waiting
+	 *
+	 * The message is copied into the transmit ring and sent by the
+	 * transmit thread, which is started by the first call. Any number of
+	 * threads may call it at once without locking each other out.
+	 * Messages taken from the ring together go out together, coalesced
+	 * if coalescing is enabled.
+	 * @param [in] preamble preamble of the packet.
+	 * @param [in] destination Receiver's address.
+	 * @param [in] source Transmitter's address.
+	 * @param [in] payload message need to be sent.
+	 * @param [in] len length of message. 
+	 * @param [in] callback called in the transmit thread when the packet
+	 * is sent or failed, or NULL.
+	 * @param [in] arg argument of callback.
+	 * @param [in] priority priority class of the packet.
+	 * @return 0: queued, -1: the ring is full or failed.
+	 */
+	int sendAsync(const void* preamble,
+				uint8_t destination, 
+				uint8_t source, 
+				const void* payload, 
+				uint32_t len,
+				CompletionType callback=NULL,
+				void *arg=NULL,
+				priority_t priority=kPriorityNormal);
+
+
+	/** 
+	 * @brief Queue message packet without transmitting it
+	 *
+	 * Assemble message packet and keep it until flush() is called.
+	 * Queued packets are transmitted first if the queue of the priority
+	 * class is full.
+	 * @param [in] preamble preamble of the packet.
+	 * @param [in] destination Receiver's address.
+	 * @param [in] source Transmitter's address.
+	 * @param [in] payload message need to be sent.
+	 * @param [in] len length of message. 
+	 * @param [in] priority priority class of the packet.
+	 * @return 0: success, -1: failed.
 	 */
-	void send(const void* preamble,
+	int post(const void* preamble,
 				uint8_t destination, 
 				uint8_t source, 
 				const void* payload, 
-				uint8_t len);
+				uint32_t len,
+				priority_t priority=kPriorityNormal);
+
+
+	/** 
+	 * @brief Transmit all queued message packets
+	 * @return 0: success, -1: failed.
+	 */
+	int flush();
+
+
+	/** 
+	 * @brief Set the scheduling between priority classes
+	 *
+	 * With strict priority, the default, a frame is sent only when no
+	 * frame of higher priority is queued, and a high priority frame waits
+	 * for MESSAGE_TX_PREEMPT_LIMIT byte on the line at most. With weights,
+	 * every class with queued frames sends up to its weight in frames
+	 * per round, so no class starves.
+	 * @param weights frames per round of each class, highest priority first,
+	 * NULL: strict priority.
+	 * @return nothing.
+	 */
+	void setScheduling(const uint8_t *weights);
 
 
 	/** 
@@ -117,6 +492,75 @@ public:
 	void setPreamble(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4);
 
 
+	/** 
+	 * @brief Set the idle time between two consecutive frames
+	 *
+	 * By default frames are sent back-to-back at wire speed.
+	 * @param gap idle time of the line in microseconds, 0: no gap.
+	 * @return nothing.
+	 */
+	void setInterFrameGap(uint32_t gap);
+
+
+	/** 
+	 * @brief Set the addresses of this node for incoming packet
+	 *
+	 * A frame is accepted if its destination matches address in the bits
+	 * set in mask, or equals broadcast. Other frames are skipped without
+	 * being checked or queued. By default every frame is accepted.
+	 * @param address local address.
+	 * @param mask bits of destination compared with address.
+	 * @param broadcast destination accepted by every node.
+	 * @return nothing.
+	 */
+	void setAddress(uint8_t address, uint8_t mask=0xFF, uint8_t broadcast=0xFF);
+
+
+	/** 
+	 * @brief Enable Reed-Solomon forward error correction
+	 *
+	 * The header, and each block of up to 255 - parity byte of payload and
+	 * checksum, carry their own parity bytes. Up to parity/2 corrupted bytes
+	 * per block are corrected before the checksum is verified. Both sides
+	 * of a link must use the same setting, set before traffic starts.
+	 * @param parity number of parity bytes per block, even, up to RS_MAX_PARITY,
+	 * 0: disabled.
+	 * @return 0: OK, -1: invalid parity.
+	 */
+	int setErrorCorrection(uint8_t parity);
+
+
+	/** 
+	 * @brief Compress outgoing payloads
+	 *
+	 * A payload is sent compressed only if it gets smaller. Compressed
+	 * payloads are flagged in the frame and expanded before pop(), whether
+	 * compression is enabled or not. A dictionary of typical content makes
+	 * short messages compress well; both sides of a link must use the same.
+	 * Needs MESSAGE_PROTOCOL_VERSION 2.
+	 * @param enable compress outgoing payloads.
+	 * @param dictionary content shared by both sides, kept by the caller, or NULL.
+	 * @param len length of dictionary in byte, up to LZ_MAX_DICTIONARY.
+	 * @return 0: OK, -1: not supported by the frame format.
+	 */
+	int setCompression(bool enable, const void *dictionary=NULL, uint32_t len=0);
+
+
+	/** 
+	 * @brief Coalesce short messages into multi-record frames
+	 *
+	 * Messages sent to the same destination with the same source and
+	 * preamble are packed into one frame, which is sent when no other
+	 * message fits, when it is delay old, or by flush(). The receiver
+	 * splits it back into separate Messages, whether coalescing is
+	 * enabled or not. Needs MESSAGE_PROTOCOL_VERSION 2.
+	 * @param delay maximum waiting time of a message in microseconds,
+	 * 0: disabled, the pending batch is sent.
+	 * @return 0: OK, -1: failed or not supported by the frame format.
+	 */
+	int setCoalescing(uint32_t delay);
+
+
 	/**
 	 * @brief Pop the oldest Message from Message Box
 	 * @param message pointer to Message instance;
@@ -133,6 +577,51 @@ public:
 	int pop(Message_t *message);
 
 
+	/**
+	 * @brief Pop the oldest Message, waiting until one is available
+	 * @param message Message instance;
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int pop(Message_t &message, int timeout);
+
+
+	/**
+	 * @brief Borrow the oldest Message without copying it
+	 *
+	 * The view stays valid until consume() is called.
+	 * @param view view of the Message.
+	 * @return 0: success, -1: failed.
+	 */
+	int peek(MessageView_t &view);
+
+
+	/**
+	 * @brief Borrow the oldest Message, waiting until one is available
+	 * @param view view of the Message;
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int peek(MessageView_t &view, int timeout);
+
+
+	/**
+	 * @brief Release the Message borrowed by peek()
+	 * @return nothing.
+	 */
+	void consume();
+
+
+	/**
+	 * @brief Get the file descriptor signalling new Messages
+	 *
+	 * The descriptor is readable while a Message is available, so it can
+	 * be added to poll/select/epoll. Do not read from it.
+	 * @return eventfd file descriptor.
+	 */
+	int getEventFd();
+
+
 	/**
 	 * @brief Check if new Message is available
 	 * @return true/false.
@@ -142,57 +631,299 @@ public:
 
 private:
 
-	void createFrame(const void* preamble,
+	/** 
+	 * @brief Message waiting for the transmit thread
+	 */
+	struct Job_t {
+		uint8_t preamble[MESSAGE_PREAMBLE_SIZE]; /**< preamble of the packet */
+		uint8_t destination; /**< receiver's address */
+		uint8_t source; /**< transmitter's address */
+		priority_t priority; /**< priority class of the packet */
+		uint32_t len; /**< length of message */
+		CompletionType callback; /**< completion function, or NULL */
+		void *arg; /**< argument of callback */
+		uint8_t payload[MESSAGE_MAX_PAYLOAD_SIZE]; /**< message */
+	};
+
+	/** 
+	 * @brief Results of the messages of sendAsync() carried by a frame
+	 */
+	struct Report_t {
+		int *result; /**< first result, the others follow, or NULL */
+		uint32_t count; /**< number of results */
+	};
+
+	/** 
+	 * @brief Send the messages of the transmit ring
+	 * @param arg pointer to MessageBox.
+	 * @return NULL.
+	 */
+	static void* transmitThread(void *arg);
+
+	void createFrame(MessageFrame_t *frame,
+						const void* preamble,
 						uint8_t destination, 
 						uint8_t source, 
 						const void* payload, 
-						uint8_t len);
+						uint32_t len,
+						uint8_t control=0);
+
+	/** 
+	 * @brief Queue a frame, txLock is held
+	 * @param result set to -1 if the frame is not sent completely, or NULL.
+	 * @return 0: success, -1: failed.
+	 */
+	int enqueue(const void* preamble,
+				uint8_t destination, 
+				uint8_t source, 
+				const void* payload, 
+				uint32_t len,
+				priority_t priority,
+				int *result=NULL);
+
+	/** 
+	 * @brief Transmit until the queue of a priority class has a free frame,
+	 * txLock is held
+	 * @param level the priority class.
+	 * @return 0: success, -1: failed.
+	 */
+	int makeRoom(uint8_t level);
+
+	/** 
+	 * @brief Transmit until the given frames are sent, txLock is held
+	 *
+	 * Frames of every class are sent in schedule order meanwhile,
+	 * by this thread or by the thread already transmitting.
+	 * @param tickets number of frames to be sent in each class since start.
+	 * @return 0: success, -1: failed.
+	 */
+	int transmitUntil(const uint64_t *tickets);
+
+	/** 
+	 * @brief Check whether the given frames are sent, txLock is held
+	 * @param tickets number of frames to be sent in each class since start.
+	 * @return true/false.
+	 */
+	bool isSent(const uint64_t *tickets);
+
+	/** 
+	 * @brief Send the frames the line can take now, or wait until it can,
+	 * txLock is held
+	 * @return 0: success, -1: failed.
+	 */
+	int transmitNext();
+
+	/** 
+	 * @brief Choose the priority class of the next frame, txLock is held
+	 * @return the priority class, -1: no frame is queued.
+	 */
+	int schedule();
+
+	/** 
+	 * @brief Add a message to the pending batch, txLock is held
+	 * @param result set to -1 if the batch is not sent completely, or NULL,
+	 * it follows the result of the previous message of the batch.
+	 * @return 0: success, -1: failed.
+	 */
+	int coalesce(const void* preamble,
+				uint8_t destination, 
+				uint8_t source, 
+				const void* payload, 
+				uint32_t len,
+				priority_t priority,
+				int *result=NULL);
+
+	/** 
+	 * @brief Turn the pending batch into a queued frame, txLock is held
+	 * @return 0: success, -1: failed.
+	 */
+	int closeBatch();
+
+	/** 
+	 * @brief Transmit until the frame of the last batch is sent, txLock is held
+	 * @return 0: success, -1: failed.
+	 */
+	int sendBatch();
+
+	/** 
+	 * @brief Send the pending batch when it is due
+	 * @param arg pointer to MessageBox.
+	 * @return NULL.
+	 */
+	static void* coalesceThread(void *arg);
+
+	/** 
+	 * @brief Wait for the idle time between frames
+	 * @return nothing.
+	 */
+	void pace();
+
+	/** 
+	 * @brief Pace and write a group of frames
+	 * @param vector array of buffers.
+	 * @param count the number of buffers.
+	 * @param len the total length of buffers in byte.
+	 * @return the number of bytes written, less than len: Error.
+	 */
+	uint32_t transmit(const struct iovec* vector, int count, uint32_t len);
+
+	/** 
+	 * @brief Add error correction to a frame
+	 * @param frame the frame.
+	 * @param out buffer for the coded frame.
+	 * @return length of the coded frame in byte.
+	 */
+	uint32_t encodeFrame(const MessageFrame_t *frame, uint8_t *out);
+
+	/** 
+	 * @brief Gather a coded block of incoming data, then correct and parse it
+	 * @param data pointer to incoming data;
+	 * @param len the length of data in byte.
+	 * @return the number of bytes used.
+	 */
+	uint32_t collect(const uint8_t *data, uint32_t len);
+
+	/** 
+	 * @brief Expand a compressed payload into a FIFO slot
+	 * @return size of the expanded payload, rxSlot is NULL on failure.
+	 */
+	uint32_t expand();
+
+	/** 
+	 * @brief Split a batch frame into Messages
+	 * @return nothing.
+	 */
+	void unpack();
+
+	/** 
+	 * @brief Commit the message in rxSlot to FIFO
+	 * @param size size of the payload.
+	 * @return nothing.
+	 */
+	void store(uint32_t size);
 
 	/** 
 	 * @brief Check the integrity of the data
+	 *
+	 * The checksum is computed while the frame is received,
+	 * only the comparison is left.
 	 * @return 0: OK, -1: Error
 	 */
 	int verifyChecksum();
 	
 
 	/**
-	 * @brief Extract message from received frame.
-	 * @param rxFrame received frame.
-	 * @return pointer to new Message.
+	 * @brief Clear FIFO buffer.
+	 * @return nothing.
 	 */
-	Message_t extractMessage(MessageFrame_t *rxFrame);
+	void clear();
 
+	/**
+	 * @brief Read all available data and parse it
+	 * @return nothing.
+	 */
+	void receive();
 
 	/**
-	 * @brief Clear FIFO buffer.
+	 * @brief Receive incoming data, callback given to the device
+	 * @param arg pointer to MessageBox.
 	 * @return nothing.
 	 */
-	void clear();
+	static void onReceive(void *arg);
 
-	static void parsePreamble(void *);
-	static void parseAddress(void *);
-	static void parseSize(void *);
-	static void parsePayload(void *);
-	static void parseChecksum(void *);
+	/**
+	 * @brief Run the receiving procedure over a chunk of incoming data
+	 * @param data pointer to incoming data;
+	 * @param len the length of data in byte.
+	 * @return nothing.
+	 */
+	void parse(const uint8_t *data, uint32_t len);
+
+	/**
+	 * @brief Finish receiving procedure of the current frame
+	 * @return nothing.
+	 */
+	void finishFrame();
 
 	T& device; /**< Physical layer device */
 
 	MessageFrame_t *rxFrame; /**< @brief frame for incoming message */
-	MessageFrame_t *txFrame; /**< @brief frame for outgoing message */
-
-	std::queue<Message_t> FIFO; /**< FIFO buffer containing Messages */
+	MessageFrame_t *txFrames; /**< @brief frames for outgoing messages, a ring per priority class */
+	Report_t *txReports; /**< results reported by each frame of txFrames */
+	uint32_t txHead[MESSAGE_PRIORITY_LEVELS]; /**< @brief oldest queued frame of each class */
+	uint32_t txCount[MESSAGE_PRIORITY_LEVELS]; /**< @brief number of queued frames of each class */
+	uint64_t txQueued[MESSAGE_PRIORITY_LEVELS]; /**< number of frames queued since start */
+	uint64_t txSent[MESSAGE_PRIORITY_LEVELS]; /**< number of frames sent since start */
+	bool txWeighted; /**< weighted scheduling, or strict priority */
+	uint8_t txWeights[MESSAGE_PRIORITY_LEVELS]; /**< frames per round of each class */
+	uint8_t txCredit[MESSAGE_PRIORITY_LEVELS]; /**< frames left in this round */
+	bool txBusy; /**< a thread is transmitting */
+	pthread_mutex_t txLock; /**< protects outgoing frames */
+	pthread_cond_t txProgress; /**< signalled when frames are sent or transmission is free */
+
+	SharedRingBuffer<Job_t, MESSAGE_TX_RING_SIZE> *txRing; /**< messages of sendAsync() */
+	int txWakeup; /**< eventfd waking up the transmit thread */
+	std::atomic<bool> txIdle; /**< the transmit thread waits for txWakeup */
+	std::atomic<bool> txStopping; /**< the transmit thread is asked to exit */
+	std::atomic<bool> txThreadRunning; /**< state of the transmit thread */
+	pthread_t txThread; /**< transmit thread ID */
+
+	MessageQueue FIFO; /**< FIFO buffer containing Messages */
 
 	step_t currentStep;
+	uint32_t rxCount; /**< number of bytes received in the current step */
+	uint8_t *rxPayload; /**< destination of incoming payload, a FIFO slot if one is free */
+	Message_t *rxSlot; /**< FIFO slot reserved for the incoming message, or NULL */
+
+	uint8_t localAddress; /**< address of this node */
+	uint8_t addressMask; /**< bits of destination compared with localAddress */
+	uint8_t broadcastAddress; /**< destination accepted by every node */
+	bool rxAccepted; /**< the incoming frame is for this node */
+	uint32_t rxSkip; /**< number of bytes to skip after the header of a rejected frame */
+
+	rs_codec_t fecCodec; /**< error correcting code */
+	uint8_t fecParity; /**< parity bytes per block, 0: no error correction */
+	uint8_t *txCoded; /**< coded outgoing frames */
+	uint32_t txCodedSize; /**< maximum size of one coded frame */
+	bool fecInner; /**< corrected data is being parsed */
+	uint32_t fecCount; /**< number of bytes of the current block */
+	uint32_t fecLength; /**< length of the current block */
+	uint32_t fecRemaining; /**< payload and checksum bytes still to be gathered */
+	uint8_t fecBlock[RS_MAX_BLOCK]; /**< current block */
+
+	bool compression; /**< outgoing payloads are compressed */
+	lz_dictionary_t *dictionary; /**< shared history of compression, or NULL */
+	uint8_t *rxRecords; /**< expanded payload of a compressed batch */
+
+	uint32_t coalesceDelay; /**< maximum waiting time of a batched message in microseconds, 0: disabled */
+	uint8_t *batchRecords; /**< records of the pending batch */
+	uint32_t batchSize; /**< length of the records in byte */
+	uint32_t batchCount; /**< number of records */
+	Report_t batchReport; /**< results reported by the pending batch */
+	uint8_t batchPreamble[MESSAGE_PREAMBLE_SIZE]; /**< preamble of the pending batch */
+	uint8_t batchAddress[2]; /**< destination and source of the pending batch */
+	priority_t batchPriority; /**< priority class of the pending batch */
+	uint64_t batchDeadline; /**< time when the pending batch is sent, in ns */
+	pthread_cond_t batchPending; /**< signalled when a batch is started */
+	bool batchStopping; /**< coalesceThread is asked to exit */
+	bool batchThreadRunning; /**< state of coalesceThread */
+	pthread_t batchThread; /**< coalesceThread ID */
+
+	uint32_t interFrameGap; /**< idle time between frames in microseconds */
+	uint64_t lineIdle; /**< estimated time when the line becomes idle, in ns */
 
 	uint8_t validPreamble[MESSAGE_PREAMBLE_SIZE] = {0xAA, 0xBB, 0xCC, 0xDD};
+	crc32_t preambleChecksum; /**< checksum of validPreamble */
+	uint8_t preambleFallback[MESSAGE_PREAMBLE_SIZE]; /**< KMP failure table of validPreamble */
+	crc32_t rxChecksum; /**< running checksum of the incoming frame */
 
-	CallbackType callback[5];
+	uint8_t rxBuffer[MESSAGE_RX_CHUNK_SIZE]; /**< @brief buffer for incoming data */
 
-	friend void ISR(void *arg);
 };
 
-void ISR(void* arg);
-
+} /* namespace MESSAGE_CONFIG */
 } /* namespace eLinux */
 
+#include "message_impl.h"
+
 #endif /* __MESSAGE__ */
\ No newline at end of file
@@ -0,0 +1,1641 @@
+/** 
+ * @file message_impl.h
+ * @brief Implementations for MessageBox protocol
+ *  
+ * This C++ library is used to create Data Link Layer for existed Physical Layers,
+ * such as UART, SPI, I2C,...
+ * It is included by message.h, so MessageBox works with any transport.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 2, 2020
+ */
+
+
+#ifndef __MESSAGE_IMPL__
+#define __MESSAGE_IMPL__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "message.h"
+
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+/** 
+ * @brief Struct containing message frame
+ */
+struct MessageFrame_t {
+	uint8_t preamble[MESSAGE_PREAMBLE_SIZE]; /**< @brief preamble of message frame */
+	uint8_t address[2]; /**< @brief destination and source address: 2 bytes */
+#if MESSAGE_CONTROL_SIZE
+	uint8_t control; /**< @brief control flags */
+#endif
+	message_size_t payloadSize; /**< @brief size of payload  */
+	uint8_t payload[MESSAGE_MAX_PAYLOAD_SIZE]; /**< @brief array contains payload */
+	crc32_t checksum; /**< @brief CRC-32 checksum */
+#if !MESSAGE_CONTROL_SIZE
+	uint8_t control; /**< @brief control flags, always 0, not sent in version 1 */
+#endif
+} __attribute__((packed));
+
+
+/**
+ * @brief Read the monotonic clock
+ * @return current time in nanoseconds.
+ */
+inline uint64_t monotonicTime() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/**
+ * @brief Sleep for a period of time
+ * @param duration time in nanoseconds.
+ * @return nothing.
+ */
+inline void sleepFor(uint64_t duration) {
+	struct timespec period;
+
+	period.tv_sec = duration / 1000000000ULL;
+	period.tv_nsec = duration % 1000000000ULL;
+
+	while (nanosleep(&period, &period) < 0 && errno == EINTR);
+}
+
+
+// always room for two messages of maximum size
+inline MessageQueue::MessageQueue(uint32_t budget):
+	arena(budget > 4 * (sizeof(Message_t) + 8) ? budget : 4 * (sizeof(Message_t) + 8))
+{
+	if ((this->eventfd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		perror("MessageQueue: Failed to create eventfd");
+	}
+}
+
+
+inline MessageQueue::~MessageQueue() {
+	::close(this->eventfd);
+}
+
+
+inline Message_t* MessageQueue::reserve(uint32_t size) {
+	return (Message_t*)this->arena.reserve(offsetof(Message_t, payload) + size);
+}
+
+
+inline void MessageQueue::commit() {
+	uint32_t span = this->arena.commit();
+
+	// only the first message after the queue ran empty signals eventfd
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (this->arena.size() <= span) {
+		notify();
+	}
+}
+
+
+inline int MessageQueue::peek(MessageView_t &view) {
+	uint32_t size;
+	Message_t *data = (Message_t*)this->arena.front(size);
+
+	if (data == NULL) {
+		return -1;
+	}
+
+	view.address = data->address;
+	view.payloadSize = data->payloadSize;
+	view.payload = data->payload;
+
+	return 0;
+}
+
+
+inline void MessageQueue::consume() {
+	this->arena.drop();
+
+	// reset eventfd when the queue runs empty, then catch a racing commit
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (this->arena.empty()) {
+		uint64_t value;
+
+		if (::read(this->eventfd, &value, sizeof(value)) > 0 && !this->arena.empty()) {
+			notify();
+		}
+	}
+}
+
+
+inline int MessageQueue::pop(Message_t &message) {
+	MessageView_t view;
+
+	if (peek(view) < 0) {
+		return -1;
+	}
+
+	message.address = view.address;
+	message.payloadSize = view.payloadSize;
+	memcpy(message.payload, view.payload, message.payloadSize);
+
+	consume();
+
+	return 0;
+}
+
+
+inline int MessageQueue::wait(int timeout) {
+	uint64_t deadline = monotonicTime() + (uint64_t)timeout * 1000000ULL;
+	struct pollfd event;
+
+	event.fd = this->eventfd;
+	event.events = POLLIN;
+
+	while (this->arena.empty()) {
+		int remaining = -1;
+
+		if (timeout >= 0) {
+			uint64_t now = monotonicTime();
+
+			if (now >= deadline) {
+				return -1;
+			}
+
+			remaining = (deadline - now + 999999) / 1000000;
+		}
+
+		if (poll(&event, 1, remaining) < 0 && errno != EINTR) {
+			perror("MessageQueue: Failed to wait for messages");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+inline int MessageQueue::getEventFd() {
+	return this->eventfd;
+}
+
+
+inline bool MessageQueue::empty() {
+	return this->arena.empty();
+}
+
+
+inline void MessageQueue::notify() {
+	uint64_t value = 1;
+
+	if (::write(this->eventfd, &value, sizeof(value)) < 0) {
+		perror("MessageQueue: Failed to signal eventfd");
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+MessageBox<T>::MessageBox(T& _device, uint32_t budget): 
+	device{_device},
+	FIFO(budget)
+{
+
+	this->txFrames = new MessageFrame_t[MESSAGE_PRIORITY_LEVELS * MESSAGE_TX_BATCH_SIZE];
+	this->txReports = new Report_t[MESSAGE_PRIORITY_LEVELS * MESSAGE_TX_BATCH_SIZE];
+	this->rxFrame = new MessageFrame_t;
+
+	for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+		this->txHead[level] = 0;
+		this->txCount[level] = 0;
+		this->txQueued[level] = 0;
+		this->txSent[level] = 0;
+		this->txWeights[level] = 1;
+		this->txCredit[level] = 1;
+	}
+
+	this->txWeighted = false;
+	this->txBusy = false;
+	pthread_mutex_init(&this->txLock, NULL);
+
+	this->txRing = new SharedRingBuffer<Job_t, MESSAGE_TX_RING_SIZE>;
+	this->txIdle = false;
+	this->txStopping = false;
+	this->txThreadRunning = false;
+
+	if ((this->txWakeup = ::eventfd(0, EFD_CLOEXEC)) < 0) {
+		perror("MessageBox: Failed to create eventfd");
+	}
+
+	this->currentStep = kParsingPreamble;
+	this->rxCount = 0;
+	this->rxPayload = this->rxFrame->payload;
+	this->rxSlot = NULL;
+	setPreamble(this->validPreamble[0], this->validPreamble[1], 
+				this->validPreamble[2], this->validPreamble[3]);
+
+	this->localAddress = 0;
+	this->addressMask = 0;
+	this->broadcastAddress = 0xFF;
+	this->rxAccepted = true;
+	this->rxSkip = 0;
+
+	this->fecParity = 0;
+	this->txCoded = NULL;
+	this->txCodedSize = 0;
+	this->fecInner = false;
+	this->fecCount = 0;
+	this->fecLength = 0;
+	this->fecRemaining = 0;
+
+	this->compression = false;
+	this->dictionary = NULL;
+	this->rxRecords = new uint8_t[MESSAGE_MAX_PAYLOAD_SIZE];
+
+	this->coalesceDelay = 0;
+	this->batchRecords = new uint8_t[MESSAGE_MAX_PAYLOAD_SIZE];
+	this->batchSize = 0;
+	this->batchCount = 0;
+	this->batchReport.result = NULL;
+	this->batchReport.count = 0;
+	this->batchPriority = kPriorityNormal;
+	this->batchDeadline = 0;
+	this->batchStopping = false;
+	this->batchThreadRunning = false;
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&this->batchPending, &attr);
+	pthread_cond_init(&this->txProgress, &attr);
+	pthread_condattr_destroy(&attr);
+
+	this->interFrameGap = 0;
+	this->lineIdle = 0;
+
+	this->device.onReceiveData(onReceive, this);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+MessageBox<T>::~MessageBox() {
+	uint64_t tickets[MESSAGE_PRIORITY_LEVELS];
+
+	// messages in the transmit ring are sent before the thread exits
+	if (this->txThreadRunning) {
+		uint64_t value = 1;
+
+		this->txStopping = true;
+
+		if (::write(this->txWakeup, &value, sizeof(value)) < 0) {
+			perror("MessageBox: Failed to wake up thread");
+		}
+
+		pthread_join(this->txThread, NULL);
+	}
+
+	pthread_mutex_lock(&this->txLock);
+	this->batchStopping = true;
+	pthread_cond_signal(&this->batchPending);
+
+	// frames accepted by send() are sent, the pending batch as well
+	closeBatch();
+	memcpy(tickets, this->txQueued, sizeof(tickets));
+	transmitUntil(tickets);
+
+	pthread_mutex_unlock(&this->txLock);
+
+	if (this->batchThreadRunning) {
+		pthread_join(this->batchThread, NULL);
+	}
+
+	this->device.onReceiveData(NULL, NULL);
+	clear();
+	::close(this->txWakeup);
+	delete this->txRing;
+	delete this->rxFrame;
+	delete[] this->txFrames;
+	delete[] this->txReports;
+	delete[] this->txCoded;
+	delete this->dictionary;
+	delete[] this->rxRecords;
+	delete[] this->batchRecords;
+
+	pthread_cond_destroy(&this->batchPending);
+	pthread_cond_destroy(&this->txProgress);
+	pthread_mutex_destroy(&this->txLock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::send(const void* preamble,
+					uint8_t destination, 
+					uint8_t source, 
+					const void* payload, 
+					uint32_t len,
+					priority_t priority)
+{
+	int ret;
+
+	pthread_mutex_lock(&this->txLock);
+
+	if (this->coalesceDelay && sizeof(message_size_t) + len <= MESSAGE_MAX_PAYLOAD_SIZE) {
+		ret = coalesce(preamble, destination, source, payload, len, priority);
+	}
+	else {
+		uint64_t tickets[MESSAGE_PRIORITY_LEVELS] = {0};
+
+		ret = enqueue(preamble, destination, source, payload, len, priority);
+
+		// wait for the frames scheduled before this one
+		for (int level = 0; level <= priority; level++) {
+			tickets[level] = this->txQueued[level];
+		}
+
+		if (transmitUntil(tickets) < 0) {
+			ret = -1;
+		}
+	}
+
+	pthread_mutex_unlock(&this->txLock);
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::sendAsync(const void* preamble,
+					uint8_t destination, 
+					uint8_t source, 
+					const void* payload, 
+					uint32_t len,
+					CompletionType callback,
+					void *arg,
+					priority_t priority)
+{
+	if (!this->txThreadRunning.load(std::memory_order_acquire)) {
+		pthread_mutex_lock(&this->txLock);
+
+		if (!this->txThreadRunning && pthread_create(&this->txThread, NULL, 
+														transmitThread, this) == 0) {
+			this->txThreadRunning.store(true, std::memory_order_release);
+		}
+
+		pthread_mutex_unlock(&this->txLock);
+
+		if (!this->txThreadRunning) {
+			perror("MessageBox: Failed to create thread");
+			return -1;
+		}
+	}
+
+	uint32_t position;
+	Job_t *job = this->txRing->back(position);
+
+	if (job == NULL) {
+		return -1;
+	}
+
+	memcpy(job->preamble, preamble, MESSAGE_PREAMBLE_SIZE);
+	job->destination = destination;
+	job->source = source;
+	job->priority = priority;
+	job->len = (len > MESSAGE_MAX_PAYLOAD_SIZE) ? MESSAGE_MAX_PAYLOAD_SIZE : len;
+	job->callback = callback;
+	job->arg = arg;
+	memcpy(job->payload, payload, job->len);
+
+	this->txRing->commit(position);
+
+	// only a waiting transmit thread is woken up
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (this->txIdle.exchange(false)) {
+		uint64_t value = 1;
+
+		if (::write(this->txWakeup, &value, sizeof(value)) < 0) {
+			perror("MessageBox: Failed to wake up thread");
+		}
+	}
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void* MessageBox<T>::transmitThread(void *arg) {
+	MessageBox<T> *box = (MessageBox<T>*)arg;
+
+	for (;;) {
+		CompletionType callbacks[MESSAGE_TX_BATCH_SIZE];
+		void *args[MESSAGE_TX_BATCH_SIZE];
+		int results[MESSAGE_TX_BATCH_SIZE];
+		uint64_t tickets[MESSAGE_PRIORITY_LEVELS] = {0};
+		uint32_t count = 0;
+
+		pthread_mutex_lock(&box->txLock);
+
+		while (count < MESSAGE_TX_BATCH_SIZE) {
+			Job_t *job = box->txRing->front();
+
+			if (job == NULL) {
+				break;
+			}
+
+			// the frame carrying the message sets its result when it is written
+			results[count] = 0;
+
+			if (box->coalesceDelay && sizeof(message_size_t) + job->len <= MESSAGE_MAX_PAYLOAD_SIZE) {
+				box->coalesce(job->preamble, job->destination, job->source, 
+								job->payload, job->len, job->priority, &results[count]);
+			}
+			else {
+				box->enqueue(job->preamble, job->destination, job->source, 
+								job->payload, job->len, job->priority, &results[count]);
+			}
+
+			callbacks[count] = job->callback;
+			args[count] = job->arg;
+			count++;
+
+			box->txRing->drop();
+		}
+
+		if (count) {
+			// the batch is not held back, later messages wait in the ring
+			box->closeBatch();
+
+			for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+				tickets[level] = box->txQueued[level];
+			}
+
+			box->transmitUntil(tickets);
+		}
+
+		pthread_mutex_unlock(&box->txLock);
+
+		for (uint32_t i = 0; i < count; i++) {
+			if (callbacks[i]) {
+				callbacks[i](results[i], args[i]);
+			}
+		}
+
+		if (count) {
+			continue;
+		}
+
+		if (box->txStopping) {
+			break;
+		}
+
+		// a producer seeing txIdle set after its commit wakes this thread up
+		box->txIdle = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!box->txRing->empty() || box->txStopping) {
+			box->txIdle = false;
+			continue;
+		}
+
+		uint64_t value;
+
+		if (::read(box->txWakeup, &value, sizeof(value)) < 0 && errno != EINTR) {
+			perror("MessageBox: Failed to wait for messages");
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::post(const void* preamble,
+					uint8_t destination, 
+					uint8_t source, 
+					const void* payload, 
+					uint32_t len,
+					priority_t priority)
+{
+	pthread_mutex_lock(&this->txLock);
+	int ret = enqueue(preamble, destination, source, payload, len, priority);
+	pthread_mutex_unlock(&this->txLock);
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::flush() {
+	uint64_t tickets[MESSAGE_PRIORITY_LEVELS];
+
+	pthread_mutex_lock(&this->txLock);
+	int ret = closeBatch();
+
+	memcpy(tickets, this->txQueued, sizeof(tickets));
+
+	if (transmitUntil(tickets) < 0) {
+		ret = -1;
+	}
+
+	pthread_mutex_unlock(&this->txLock);
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::setScheduling(const uint8_t *weights) {
+	pthread_mutex_lock(&this->txLock);
+
+	this->txWeighted = (weights != NULL);
+
+	for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+		// every class is served in a round
+		this->txWeights[level] = (weights && weights[level]) ? weights[level] : 1;
+		this->txCredit[level] = this->txWeights[level];
+	}
+
+	pthread_mutex_unlock(&this->txLock);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::enqueue(const void* preamble,
+					uint8_t destination, 
+					uint8_t source, 
+					const void* payload, 
+					uint32_t len,
+					priority_t priority,
+					int *result)
+{
+	// messages leave in the order they were given
+	int ret = closeBatch();
+
+	if (makeRoom(priority) < 0) {
+		ret = -1;
+	}
+
+	uint32_t slot = priority * MESSAGE_TX_BATCH_SIZE 
+					+ (this->txHead[priority] + this->txCount[priority]) % MESSAGE_TX_BATCH_SIZE;
+
+	createFrame(&this->txFrames[slot], preamble, destination, source, payload, len);
+	this->txReports[slot].result = result;
+	this->txReports[slot].count = (result != NULL);
+
+	this->txCount[priority]++;
+	this->txQueued[priority]++;
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::makeRoom(uint8_t level) {
+	int ret = 0;
+
+	// the lock is released while transmitting, so room is checked again
+	while (this->txCount[level] == MESSAGE_TX_BATCH_SIZE) {
+		uint64_t tickets[MESSAGE_PRIORITY_LEVELS] = {0};
+
+		tickets[level] = this->txSent[level] + 1;
+
+		if (transmitUntil(tickets) < 0) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::coalesce(const void* preamble,
+					uint8_t destination, 
+					uint8_t source, 
+					const void* payload, 
+					uint32_t len,
+					priority_t priority,
+					int *result)
+{
+	uint32_t record = sizeof(message_size_t) + len;
+	int ret = 0;
+
+	// a batch carries one destination, source, preamble and priority,
+	// another sender may start a new batch while this one is closed
+	while (this->batchCount && (this->batchAddress[0] != destination 
+								|| this->batchAddress[1] != source
+								|| this->batchPriority != priority
+								|| memcmp(this->batchPreamble, preamble, MESSAGE_PREAMBLE_SIZE) != 0
+								|| this->batchSize + record > MESSAGE_MAX_PAYLOAD_SIZE))
+	{
+		if (closeBatch() < 0 || sendBatch() < 0) {
+			ret = -1;
+		}
+	}
+
+	if (this->batchCount == 0) {
+		memcpy(this->batchPreamble, preamble, MESSAGE_PREAMBLE_SIZE);
+		this->batchAddress[0] = destination;
+		this->batchAddress[1] = source;
+		this->batchPriority = priority;
+		this->batchDeadline = monotonicTime() + (uint64_t)this->coalesceDelay * 1000;
+		pthread_cond_signal(&this->batchPending);
+	}
+
+	message_size_t size = len;
+
+	memcpy(this->batchRecords + this->batchSize, &size, sizeof(size));
+	memcpy(this->batchRecords + this->batchSize + sizeof(size), payload, len);
+	this->batchSize += record;
+	this->batchCount++;
+
+	// the results of a batch are consecutive, only the transmit thread gives them
+	if (result) {
+		if (this->batchReport.count == 0) {
+			this->batchReport.result = result;
+		}
+
+		this->batchReport.count++;
+	}
+
+	// sent at once if no other message fits
+	if (this->batchSize + sizeof(message_size_t) >= MESSAGE_MAX_PAYLOAD_SIZE) {
+		if (closeBatch() < 0 || sendBatch() < 0) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::closeBatch() {
+	int ret = 0;
+
+	if (this->batchCount == 0) {
+		return 0;
+	}
+
+	uint8_t level = this->batchPriority;
+
+	if (makeRoom(level) < 0) {
+		ret = -1;
+	}
+
+	// closed by another sender meanwhile
+	if (this->batchCount == 0) {
+		return ret;
+	}
+
+	uint32_t slot = level * MESSAGE_TX_BATCH_SIZE 
+					+ (this->txHead[level] + this->txCount[level]) % MESSAGE_TX_BATCH_SIZE;
+	MessageFrame_t *frame = &this->txFrames[slot];
+
+	// a single message needs no record
+	if (this->batchCount == 1) {
+		createFrame(frame, this->batchPreamble,
+					this->batchAddress[0], this->batchAddress[1],
+					this->batchRecords + sizeof(message_size_t), 
+					this->batchSize - sizeof(message_size_t));
+	}
+	else {
+		createFrame(frame, this->batchPreamble,
+					this->batchAddress[0], this->batchAddress[1],
+					this->batchRecords, this->batchSize, MESSAGE_CONTROL_BATCH);
+	}
+
+	this->txReports[slot] = this->batchReport;
+	this->txCount[level]++;
+	this->txQueued[level]++;
+
+	this->batchSize = 0;
+	this->batchCount = 0;
+	this->batchReport.result = NULL;
+	this->batchReport.count = 0;
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::sendBatch() {
+	uint64_t tickets[MESSAGE_PRIORITY_LEVELS] = {0};
+
+	tickets[this->batchPriority] = this->txQueued[this->batchPriority];
+
+	return transmitUntil(tickets);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::setCoalescing(uint32_t delay) {
+	int ret = 0;
+
+	// a batch is flagged in the control byte
+	if (MESSAGE_CONTROL_SIZE == 0 && delay) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&this->txLock);
+
+	this->coalesceDelay = delay;
+
+	if (delay == 0 && this->batchCount) {
+		if (closeBatch() < 0 || sendBatch() < 0) {
+			ret = -1;
+		}
+	}
+
+	if (delay && !this->batchThreadRunning) {
+		this->batchThreadRunning = (pthread_create(&this->batchThread, NULL, 
+													coalesceThread, this) == 0);
+
+		if (!this->batchThreadRunning) {
+			perror("MessageBox: Failed to create thread");
+			this->coalesceDelay = 0;
+			ret = -1;
+		}
+	}
+
+	pthread_mutex_unlock(&this->txLock);
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void* MessageBox<T>::coalesceThread(void *arg) {
+	MessageBox<T> *box = (MessageBox<T>*)arg;
+
+	pthread_mutex_lock(&box->txLock);
+
+	while (!box->batchStopping) {
+		if (box->batchCount == 0) {
+			pthread_cond_wait(&box->batchPending, &box->txLock);
+			continue;
+		}
+
+		uint64_t deadline = box->batchDeadline;
+
+		if (monotonicTime() >= deadline) {
+			box->closeBatch();
+			box->sendBatch();
+			continue;
+		}
+
+		struct timespec due;
+		due.tv_sec = deadline / 1000000000ULL;
+		due.tv_nsec = deadline % 1000000000ULL;
+
+		pthread_cond_timedwait(&box->batchPending, &box->txLock, &due);
+	}
+
+	pthread_mutex_unlock(&box->txLock);
+
+	return NULL;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+bool MessageBox<T>::isSent(const uint64_t *tickets) {
+	for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+		if (this->txSent[level] < tickets[level]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::transmitUntil(const uint64_t *tickets) {
+	int ret = 0;
+
+	while (!isSent(tickets)) {
+		// one sender transmits the frames of all, the others wait
+		if (this->txBusy) {
+			pthread_cond_wait(&this->txProgress, &this->txLock);
+			continue;
+		}
+
+		this->txBusy = true;
+
+		while (!isSent(tickets)) {
+			if (transmitNext() < 0) {
+				ret = -1;
+			}
+		}
+
+		this->txBusy = false;
+		pthread_cond_broadcast(&this->txProgress);
+	}
+
+	return ret;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::schedule() {
+	for (int round = 0; round < 2; round++) {
+		for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+			if (this->txCount[level] && (!this->txWeighted || this->txCredit[level])) {
+				return level;
+			}
+		}
+
+		if (!this->txWeighted) {
+			return -1;
+		}
+
+		// every class with frames has used its share, a new round starts
+		for (int level = 0; level < MESSAGE_PRIORITY_LEVELS; level++) {
+			this->txCredit[level] = this->txWeights[level];
+		}
+	}
+
+	return -1;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::transmitNext() {
+	struct iovec vector[2 * MESSAGE_TX_BATCH_SIZE];
+	Report_t reports[MESSAGE_TX_BATCH_SIZE];
+	uint32_t count = 0;
+	uint32_t total = 0;
+	uint64_t wait = 0;
+	int queued = 0;
+
+	// the gap passes with the lock released, the frame is chosen afterwards
+	if (this->interFrameGap) {
+		pthread_mutex_unlock(&this->txLock);
+		pace();
+		pthread_mutex_lock(&this->txLock);
+	}
+	else {
+		queued = Transport<T>::getOutputQueue(this->device);
+
+		if (queued < 0) {
+			queued = 0;
+		}
+	}
+
+	// each frame goes out as header with payload, then its checksum,
+	// or as one coded buffer
+	while (count < MESSAGE_TX_BATCH_SIZE) {
+		int level = schedule();
+
+		if (level < 0) {
+			break;
+		}
+
+		uint32_t slot = level * MESSAGE_TX_BATCH_SIZE + this->txHead[level];
+		MessageFrame_t *frame = &this->txFrames[slot];
+		struct iovec *v = &vector[2 * count];
+
+		if (this->fecParity) {
+			uint8_t *coded = this->txCoded + count * this->txCodedSize;
+
+			v[0].iov_base = coded;
+			v[0].iov_len = encodeFrame(frame, coded);
+			v[1].iov_base = NULL;
+			v[1].iov_len = 0;
+		}
+		else {
+			v[0].iov_base = frame;
+			v[0].iov_len = MESSAGE_HEADER_SIZE + frame->payloadSize;
+			v[1].iov_base = &frame->checksum;
+			v[1].iov_len = sizeof(crc32_t);
+		}
+
+		uint32_t len = v[0].iov_len + v[1].iov_len;
+
+		// frames of lower priority keep the output queue short,
+		// so a high priority frame waits for one frame at most
+		uint32_t limit = (level == kPriorityHigh) ? MESSAGE_TX_QUEUE_LIMIT 
+												: MESSAGE_TX_PREEMPT_LIMIT;
+
+		if (count && (this->interFrameGap || queued + total + len > limit)) {
+			break;
+		}
+
+		if (count == 0 && queued > 0 && queued + len > limit) {
+			wait = (uint64_t)(queued + len - limit) * Transport<T>::getCharacterTime(this->device);
+			break;
+		}
+
+		reports[count] = this->txReports[slot];
+		this->txHead[level] = (this->txHead[level] + 1) % MESSAGE_TX_BATCH_SIZE;
+		this->txCount[level]--;
+		this->txSent[level]++;
+
+		if (this->txCredit[level]) {
+			this->txCredit[level]--;
+		}
+
+		total += len;
+		count++;
+	}
+
+	// the schedule is evaluated again after waiting, a more urgent frame
+	// may have been queued meanwhile
+	if (count == 0) {
+		pthread_mutex_unlock(&this->txLock);
+		sleepFor(wait);
+		pthread_mutex_lock(&this->txLock);
+
+		return 0;
+	}
+
+	uint32_t written = transmit(vector, 2 * count, total);
+	uint32_t end = 0;
+
+	// a frame is sent if all its bytes are written
+	for (uint32_t i = 0; i < count; i++) {
+		end += vector[2 * i].iov_len + vector[2 * i + 1].iov_len;
+
+		if (end > written) {
+			for (uint32_t k = 0; k < reports[i].count; k++) {
+				reports[i].result[k] = -1;
+			}
+		}
+	}
+
+	pthread_cond_broadcast(&this->txProgress);
+
+	return (written < total) ? -1 : 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t MessageBox<T>::transmit(const struct iovec* vector, int count, uint32_t len) {
+	int written = Transport<T>::sendv(this->device, vector, count);
+
+	if (written < 0) {
+		return 0;
+	}
+
+	if ((uint32_t)written < len) {
+		return written;
+	}
+
+	// the frames leave the line after everything queued before them
+	uint64_t now = monotonicTime();
+
+	if (this->lineIdle < now) {
+		this->lineIdle = now;
+	}
+
+	this->lineIdle += (uint64_t)len * Transport<T>::getCharacterTime(this->device);
+
+	return len;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::setInterFrameGap(uint32_t gap) {
+	this->interFrameGap = gap;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::setAddress(uint8_t address, uint8_t mask, uint8_t broadcast) {
+	this->localAddress = address;
+	this->addressMask = mask;
+	this->broadcastAddress = broadcast;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::setErrorCorrection(uint8_t parity) {
+	if (parity && rs_init(&this->fecCodec, parity) < 0) {
+		return -1;
+	}
+
+	uint32_t body = MESSAGE_MAX_PAYLOAD_SIZE + sizeof(crc32_t);
+	uint32_t blocks = (body + RS_MAX_BLOCK - parity - 1) / (RS_MAX_BLOCK - parity);
+
+	delete[] this->txCoded;
+	this->txCoded = NULL;
+	this->fecParity = parity;
+
+	if (parity) {
+		this->txCodedSize = MESSAGE_HEADER_SIZE + parity + body + blocks * parity;
+		this->txCoded = new uint8_t[MESSAGE_TX_BATCH_SIZE * this->txCodedSize];
+	}
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::setCompression(bool enable, const void *dictionary, uint32_t len) {
+	// a compressed payload is flagged in the control byte
+	if (MESSAGE_CONTROL_SIZE == 0 && enable) {
+		return -1;
+	}
+
+	this->compression = enable;
+
+	delete this->dictionary;
+	this->dictionary = NULL;
+
+	if (dictionary && len) {
+		this->dictionary = new lz_dictionary_t;
+		lz_dictionary(this->dictionary, dictionary, len);
+	}
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t MessageBox<T>::encodeFrame(const MessageFrame_t *frame, uint8_t *out) {
+	uint32_t parity = this->fecParity;
+	uint32_t body = frame->payloadSize + sizeof(crc32_t);
+	uint32_t len = MESSAGE_HEADER_SIZE;
+
+	// preamble stays plain for synchronization, the header is one block
+	memcpy(out, frame, MESSAGE_HEADER_SIZE);
+	rs_encode(&this->fecCodec, out + MESSAGE_PREAMBLE_SIZE, 
+				MESSAGE_HEADER_SIZE - MESSAGE_PREAMBLE_SIZE, out + len);
+	len += parity;
+
+	// payload and checksum in blocks
+	for (uint32_t offset = 0; offset < body; ) {
+		uint32_t n = body - offset;
+		uint8_t *block = out + len;
+
+		if (n > RS_MAX_BLOCK - parity) {
+			n = RS_MAX_BLOCK - parity;
+		}
+
+		for (uint32_t i = 0; i < n; i++, offset++) {
+			block[i] = (offset < frame->payloadSize) ? frame->payload[offset] 
+						: ((const uint8_t*)&frame->checksum)[offset - frame->payloadSize];
+		}
+
+		rs_encode(&this->fecCodec, block, n, block + n);
+		len += n + parity;
+	}
+
+	return len;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t MessageBox<T>::collect(const uint8_t *data, uint32_t len) {
+	bool header = (this->currentStep == kParsingAddress);
+	uint32_t blockData = RS_MAX_BLOCK - this->fecParity;
+
+	if (this->fecCount == 0) {
+		uint32_t n = header ? MESSAGE_HEADER_SIZE - MESSAGE_PREAMBLE_SIZE : this->fecRemaining;
+
+		if (n > blockData) {
+			n = blockData;
+		}
+
+		this->fecLength = n + this->fecParity;
+	}
+
+	uint32_t n = this->fecLength - this->fecCount;
+
+	if (n > len) {
+		n = len;
+	}
+
+	memcpy(this->fecBlock + this->fecCount, data, n);
+	this->fecCount += n;
+
+	if (this->fecCount < this->fecLength) {
+		return n;
+	}
+
+	this->fecCount = 0;
+
+	if (rs_decode(&this->fecCodec, this->fecBlock, this->fecLength) < 0) {
+		this->rxCount = 0;
+		this->rxSlot = NULL;
+		this->currentStep = kParsingPreamble;
+		return n;
+	}
+
+	uint32_t k = this->fecLength - this->fecParity;
+
+	this->fecInner = true;
+	parse(this->fecBlock, k);
+	this->fecInner = false;
+
+	if (header) {
+		uint32_t body = this->rxFrame->payloadSize + sizeof(crc32_t);
+		uint32_t blocks = (body + blockData - 1) / blockData;
+
+		// a rejected frame is skipped with its parity, unchecked
+		this->rxSkip = body + blocks * this->fecParity;
+		this->fecRemaining = body;
+	}
+	else {
+		this->fecRemaining -= k;
+	}
+
+	return n;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::pace() {
+	uint64_t now = monotonicTime();
+
+	// the gap starts when the previous frame has left the line
+	if (now < this->lineIdle) {
+		Transport<T>::drain(this->device);
+		now = monotonicTime();
+		this->lineIdle = now;
+	}
+
+	uint64_t start = this->lineIdle + (uint64_t)this->interFrameGap * 1000;
+
+	if (now < start) {
+		sleepFor(start - now);
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::setPreamble(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) {
+	this->validPreamble[0] = b1;
+	this->validPreamble[1] = b2;
+	this->validPreamble[2] = b3;
+	this->validPreamble[3] = b4;
+
+	this->preambleChecksum = crc32_compute(this->validPreamble, MESSAGE_PREAMBLE_SIZE);
+
+	// preambleFallback[i]: length of the longest proper prefix which is also
+	// a suffix of the first i + 1 bytes
+	this->preambleFallback[0] = 0;
+
+	for (uint32_t i = 1, k = 0; i < MESSAGE_PREAMBLE_SIZE; i++) {
+		while (k > 0 && this->validPreamble[i] != this->validPreamble[k]) {
+			k = this->preambleFallback[k - 1];
+		}
+
+		if (this->validPreamble[i] == this->validPreamble[k]) {
+			k++;
+		}
+
+		this->preambleFallback[i] = k;
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::createFrame(MessageFrame_t *frame,
+							const void* _preamble,
+							uint8_t destination, 
+							uint8_t source, 
+							const void* _payload, 
+							uint32_t len,
+							uint8_t control) 
+{
+	const uint8_t* preamble = (const uint8_t*)_preamble;
+	const uint8_t* payload = (const uint8_t*)_payload;
+
+	// PREAMBLE
+	for (uint8_t i = 0; i < MESSAGE_PREAMBLE_SIZE; i++) {
+		frame->preamble[i] = preamble[i];
+	}
+
+
+	// ADDRESS
+	frame->address[0] = destination;
+	frame->address[1] = source;
+	frame->control = control;
+
+
+	// PAYLOAD SIZE
+	message_size_t size = (len > MESSAGE_MAX_PAYLOAD_SIZE) ? 
+									MESSAGE_MAX_PAYLOAD_SIZE : len;
+
+	// compressed payload: original size, then the compressed data
+	if (this->compression && size > sizeof(message_size_t) + 1) {
+		uint32_t n = lz_compress(this->dictionary, payload, size,
+								frame->payload + sizeof(message_size_t), 
+								size - sizeof(message_size_t) - 1);
+
+		if (n > 0) {
+			memcpy(frame->payload, &size, sizeof(message_size_t));
+			frame->control |= MESSAGE_CONTROL_COMPRESSED;
+			frame->payloadSize = sizeof(message_size_t) + n;
+			frame->checksum = crc32_concat(crc32_compute(frame, MESSAGE_HEADER_SIZE),
+											frame->payload, frame->payloadSize);
+			return;
+		}
+	}
+
+	frame->payloadSize = size;
+
+
+	// PAYLOAD and CHECKSUM CRC32 in one pass
+	frame->checksum = crc32_copy(crc32_compute(frame, MESSAGE_HEADER_SIZE),
+								frame->payload, payload, frame->payloadSize);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::receive() {
+	int len;
+
+	// a short read means the driver buffer is empty
+	do {
+		len = this->device.receiveBuffer(this->rxBuffer, MESSAGE_RX_CHUNK_SIZE);
+
+		if (len > 0) {
+			parse(this->rxBuffer, len);
+		}
+	} while (len == MESSAGE_RX_CHUNK_SIZE);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::onReceive(void *arg) {
+	MessageBox<T> *msg = static_cast<MessageBox<T>*>(arg);
+
+	msg->receive();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::parse(const uint8_t *data, uint32_t len) {
+	const uint8_t *end = data + len;
+	uint32_t n;
+
+	while (data < end) {
+		// with error correction, blocks are corrected before they are parsed
+		if (this->fecParity && !this->fecInner && this->currentStep >= kParsingAddress 
+			&& this->currentStep <= kParsingChecksum) {
+			data += collect(data, end - data);
+			continue;
+		}
+
+		switch (this->currentStep) {
+			case kParsingPreamble:
+				// between frames, jump straight to the next candidate first byte
+				if (this->rxCount == 0) {
+					const uint8_t *first = (const uint8_t*)memchr(data, this->validPreamble[0], 
+																	end - data);
+
+					if (first == NULL) {
+						data = end;
+						break;
+					}
+
+					data = first + 1;
+					this->rxCount = 1;
+				}
+				else {
+					// on mismatch fall back to the longest matched prefix, as KMP does
+					while (this->rxCount > 0 && *data != this->validPreamble[this->rxCount]) {
+						this->rxCount = this->preambleFallback[this->rxCount - 1];
+					}
+
+					if (*data++ == this->validPreamble[this->rxCount]) {
+						this->rxCount++;
+					}
+				}
+
+				// go to next step if 4-byte preamble is read.
+				if (this->rxCount == MESSAGE_PREAMBLE_SIZE) {
+					this->rxCount = 0;
+					this->rxChecksum = this->preambleChecksum;
+					this->rxFrame->control = 0;
+					this->currentStep = kParsingAddress;
+				}
+				break;
+
+			case kParsingAddress:
+				if (this->rxCount < sizeof(this->rxFrame->address)) {
+					this->rxFrame->address[this->rxCount++] = *data++;
+				}
+				else {
+					this->rxFrame->control = *data++;
+					this->rxCount++;
+				}
+
+				// go to next step after 2-byte address and control byte
+				if (this->rxCount < sizeof(this->rxFrame->address) + MESSAGE_CONTROL_SIZE) {
+					break;
+				}
+
+				this->rxAccepted = ((this->rxFrame->address[0] ^ this->localAddress) & this->addressMask) == 0
+									|| this->rxFrame->address[0] == this->broadcastAddress;
+				this->rxCount = 0;
+				this->currentStep = kParsingSize;
+				break;
+
+			case kParsingSize:
+				((uint8_t*)&this->rxFrame->payloadSize)[this->rxCount++] = *data++;
+
+				if (this->rxCount < sizeof(message_size_t)) {
+					break;
+				}
+
+				this->rxCount = 0;
+
+				// a frame never carries more than the maximum payload
+				if (this->rxFrame->payloadSize > MESSAGE_MAX_PAYLOAD_SIZE) {
+					this->currentStep = kParsingPreamble;
+					break;
+				}
+
+				// frames for other nodes are skipped by length, unchecked
+				if (!this->rxAccepted) {
+					this->rxSkip = this->rxFrame->payloadSize + sizeof(crc32_t);
+					this->currentStep = kSkippingFrame;
+					break;
+				}
+
+				this->rxChecksum = crc32_concat(this->rxChecksum, this->rxFrame->address,
+												MESSAGE_HEADER_SIZE - MESSAGE_PREAMBLE_SIZE);
+
+				// payload goes straight into a FIFO slot of its actual size,
+				// a compressed or batch payload is received aside
+				if (this->rxFrame->control & (MESSAGE_CONTROL_COMPRESSED | MESSAGE_CONTROL_BATCH)) {
+					this->rxSlot = NULL;
+				}
+				else {
+					this->rxSlot = this->FIFO.reserve(this->rxFrame->payloadSize);
+				}
+
+				this->rxPayload = this->rxSlot ? this->rxSlot->payload : this->rxFrame->payload;
+
+				if (this->rxFrame->payloadSize == 0) {
+					this->currentStep = kParsingChecksum;
+				}
+				else {
+					this->currentStep = kParsingPayload;
+				}
+				break;
+
+			case kParsingPayload:
+				n = this->rxFrame->payloadSize - this->rxCount;
+
+				if (n > (uint32_t)(end - data)) {
+					n = end - data;
+				}
+
+				this->rxChecksum = crc32_copy(this->rxChecksum, 
+												this->rxPayload + this->rxCount, data, n);
+				data += n;
+				this->rxCount += n;
+
+				if (this->rxCount == this->rxFrame->payloadSize) {
+					this->rxCount = 0;
+					this->currentStep = kParsingChecksum;
+				}
+				break;
+
+			case kParsingChecksum:
+				n = sizeof(crc32_t) - this->rxCount;
+
+				if (n > (uint32_t)(end - data)) {
+					n = end - data;
+				}
+
+				memcpy((uint8_t*)&this->rxFrame->checksum + this->rxCount, data, n);
+				data += n;
+				this->rxCount += n;
+
+				if (this->rxCount == sizeof(crc32_t)) {
+					this->rxCount = 0;
+					this->currentStep = kVerifyingChecksum;
+					finishFrame();
+				}
+				break;
+
+			case kSkippingFrame:
+				n = this->rxSkip - this->rxCount;
+
+				if (n > (uint32_t)(end - data)) {
+					n = end - data;
+				}
+
+				data += n;
+				this->rxCount += n;
+
+				if (this->rxCount == this->rxSkip) {
+					this->rxCount = 0;
+					this->currentStep = kParsingPreamble;
+				}
+				break;
+
+			default:
+				this->rxCount = 0;
+				this->currentStep = kParsingPreamble;
+				break;
+		}
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::finishFrame() {
+	uint32_t size = this->rxFrame->payloadSize;
+
+	if (verifyChecksum() < 0) {
+		this->rxSlot = NULL;
+	}
+	else if (this->rxFrame->control & MESSAGE_CONTROL_BATCH) {
+		unpack();
+	}
+	else if (this->rxFrame->control & MESSAGE_CONTROL_COMPRESSED) {
+		size = expand();
+	}
+
+	// the message is dropped if FIFO was full
+	if (this->rxSlot != NULL) {
+		store(size);
+	}
+
+	this->currentStep = kParsingPreamble;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::store(uint32_t size) {
+	this->rxSlot->address = this->rxFrame->address[1];
+	this->rxSlot->payloadSize = size;
+	this->rxSlot = NULL;
+	this->FIFO.commit();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::unpack() {
+	const uint8_t *records = this->rxFrame->payload;
+	uint32_t len = this->rxFrame->payloadSize;
+	message_size_t size;
+
+	this->rxSlot = NULL;
+
+	if (this->rxFrame->control & MESSAGE_CONTROL_COMPRESSED) {
+		if (len < sizeof(size)) {
+			return;
+		}
+
+		memcpy(&size, records, sizeof(size));
+
+		if (size > MESSAGE_MAX_PAYLOAD_SIZE
+			|| lz_decompress(this->dictionary, records + sizeof(size), len - sizeof(size),
+								this->rxRecords, size) != size) 
+		{
+			return;
+		}
+
+		records = this->rxRecords;
+		len = size;
+	}
+
+	// each record is the size of a message, then the message
+	while (len >= sizeof(size)) {
+		memcpy(&size, records, sizeof(size));
+		records += sizeof(size);
+		len -= sizeof(size);
+
+		if (size > len) {
+			return;
+		}
+
+		// the rest of the batch is dropped if FIFO is full
+		this->rxSlot = this->FIFO.reserve(size);
+
+		if (this->rxSlot == NULL) {
+			return;
+		}
+
+		memcpy(this->rxSlot->payload, records, size);
+		store(size);
+
+		records += size;
+		len -= size;
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t MessageBox<T>::expand() {
+	message_size_t size;
+
+	this->rxSlot = NULL;
+
+	if (this->rxFrame->payloadSize < sizeof(size)) {
+		return 0;
+	}
+
+	memcpy(&size, this->rxFrame->payload, sizeof(size));
+
+	if (size > MESSAGE_MAX_PAYLOAD_SIZE) {
+		return 0;
+	}
+
+	Message_t *slot = this->FIFO.reserve(size);
+
+	if (slot && lz_decompress(this->dictionary, this->rxFrame->payload + sizeof(size),
+								this->rxFrame->payloadSize - sizeof(size),
+								slot->payload, size) == size) {
+		this->rxSlot = slot;
+	}
+
+	return size;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::verifyChecksum() {
+	if (this->rxChecksum == this->rxFrame->checksum) {
+		return 0;
+	}
+	else {
+		return -1;
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::clear() {
+	Message_t dump;
+
+	while (pop(dump) == 0);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::peek(MessageView_t &view) {
+	return this->FIFO.peek(view);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::peek(MessageView_t &view, int timeout) {
+	if (this->FIFO.wait(timeout) < 0) {
+		return -1;
+	}
+
+	return this->FIFO.peek(view);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void MessageBox<T>::consume() {
+	this->FIFO.consume();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::pop(Message_t &message) {
+	return this->FIFO.pop(message);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::pop(Message_t *message) {
+	return pop(*message);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::pop(Message_t &message, int timeout) {
+	if (this->FIFO.wait(timeout) < 0) {
+		return -1;
+	}
+
+	return this->FIFO.pop(message);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int MessageBox<T>::getEventFd() {
+	return this->FIFO.getEventFd();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+bool MessageBox<T>::isAvailable() {
+	return !this->FIFO.empty();
+}
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#endif /* __MESSAGE_IMPL__ */
@@ -0,0 +1,138 @@
+/** 
+ * @file reactor.h
+ * @brief This file contains class Reactor - an event loop serving
+ * many file descriptors from one thread
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 20, 2020
+ */
+
+#ifndef __REACTOR__
+#define __REACTOR__
+
+#include <map>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+/**
+ * @brief maximum number of events handled per wakeup
+ */
+#define REACTOR_MAX_EVENTS	16
+
+/**
+ * @brief namespace for BeagleBone Black
+ */
+namespace BBB {
+
+
+/**
+ * @brief pointer type for callback function
+ */
+typedef void (*CallbackType)(void*);
+
+
+/**
+ * @brief Class Reactor keeps one epoll instance alive and dispatches
+ * readiness of any number of file descriptors to their callbacks.
+ *
+ * Callbacks run in the thread of run(), one at a time, without the
+ * lock held. They may call add() and remove(), e.g. a coroutine resumed
+ * by a callback may destroy the object owning the file descriptors.
+ */
+class Reactor {
+public:
+
+	/**
+	 * @brief Constructor
+	 */
+	Reactor();
+
+
+	/**
+	 * @brief Destructor, stops the event loop
+	 */
+	~Reactor();
+
+
+	/**
+	 * @brief Register a file descriptor
+	 * @param fd file descriptor;
+	 * @param callback callback function on readiness;
+	 * @param arg argument of callback function;
+	 * @param events epoll events to wait for.
+	 * @return 0: OK, -1: Error.
+	 */
+	int add(int fd, CallbackType callback, void *arg, uint32_t events=EPOLLIN);
+
+
+	/**
+	 * @brief Unregister a file descriptor
+	 *
+	 * When it returns, the callback of fd is not running and will not
+	 * be called again, except if the callback itself calls it.
+	 * @param fd file descriptor.
+	 * @return 0: OK, -1: Error.
+	 */
+	int remove(int fd);
+
+
+	/**
+	 * @brief Dispatch events in the calling thread until stop() is called
+	 * @return 0: OK, -1: Error.
+	 */
+	int run();
+
+
+	/**
+	 * @brief Run the event loop in a new thread
+	 * @return 0: OK, -1: Error.
+	 */
+	int start();
+
+
+	/**
+	 * @brief Wake up the event loop and make run() return
+	 *
+	 * Waits for the thread created by start(), if any.
+	 * @return nothing.
+	 */
+	void stop();
+
+
+private:
+
+	/**
+	 * @brief Registered file descriptor
+	 */
+	struct Source {
+		CallbackType callback; /**< callback function on readiness */
+		void *arg; /**< argument for callback function */
+	};
+
+	int epollfd; /**< epoll instance */
+	int wakeupfd; /**< eventfd used to stop the event loop */
+
+	std::map<int, Source> sources; /**< registered file descriptors */
+	pthread_mutex_t lock; /**< protects sources and active */
+	pthread_cond_t finished; /**< signalled when a callback returns */
+	int active; /**< file descriptor whose callback runs, -1: none */
+	pthread_t dispatcher; /**< thread running the callback of active */
+
+	bool threadRunning; /**< state of thread, running or not */
+	pthread_t thread; /**< thread ID */
+
+
+	/**
+	 * @brief Friend function used for multi-threading
+	 * @param arg void pointer to Reactor
+	 * @return NULL
+	 */
+	friend void *threadedReactor(void* arg);
+};
+
+
+void *threadedReactor(void* arg);
+
+} /* namespace BBB */
+
+#endif /* __REACTOR__ */
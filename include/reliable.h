@@ -0,0 +1,296 @@
+/**
+ * @file reliable.h
+ * @brief Class for reliable, in-order delivery of messages
+ *
+ * Messages are numbered per destination and kept until the receiver
+ * acknowledges them. Up to a window of messages is in flight at once;
+ * lost messages are retransmitted after a timeout. The receiving side
+ * puts messages back in order before they are popped.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 6, 2020
+ */
+
+
+#ifndef __RELIABLE__
+#define __RELIABLE__
+
+#include <pthread.h>
+#include "message.h"
+
+
+/**
+ * @brief maximum number of messages in flight
+ */
+#define RELIABLE_MAX_WINDOW		32
+
+
+/**
+ * @brief number of retransmissions before the messages to a destination
+ * are dropped
+ */
+#ifndef RELIABLE_MAX_RETRIES
+#define RELIABLE_MAX_RETRIES	16
+#endif
+
+
+/**
+ * @brief control flags of a reliable frame
+ */
+#define RELIABLE_DATA			0x01 /**< frame carries a message */
+#define RELIABLE_ACK			0x02 /**< frame acknowledges messages */
+#define RELIABLE_SYNC			0x04 /**< first message of a new sequence,
+										with RELIABLE_ACK: request for a new sequence */
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+
+/**
+ * @brief Struct containing reliable header, placed before the data
+ * in the payload of each frame
+ *
+ * A data frame carries its sequence number. An acknowledgement carries
+ * the next expected sequence number, followed by a 32-bit map of the
+ * messages received after it. A resync request carries the sequence
+ * number the sender should start again at. The session tells a restarted
+ * sender from a retransmission when both start at the same number.
+ */
+struct ReliableHeader_t {
+	uint8_t control; /**< @brief control flags */
+	uint8_t sequence; /**< @brief sequence number */
+	uint16_t session; /**< @brief random number of the sending ReliableBox */
+} __attribute__((packed));
+
+
+/**
+ * @brief maximum data size of one reliable message
+ */
+#define RELIABLE_DATA_SIZE	(MESSAGE_MAX_PAYLOAD_SIZE - sizeof(ReliableHeader_t))
+
+
+/**
+ * @brief class ReliableBox used for transmitting/receiving messages reliably
+ */
+template <MESSAGE_TRANSPORT T>
+class ReliableBox {
+public:
+
+	/**
+	 * @brief Constructor, starts the service thread
+	 *
+	 * Both sides of a link must use ReliableBox.
+	 * @param box Message Box carrying the frames;
+	 * @param preamble preamble of the packets;
+	 * @param address local address, source of sent packets;
+	 * @param window maximum number of messages in flight, up to RELIABLE_MAX_WINDOW;
+	 * @param timeout time in milliseconds before a message is retransmitted;
+	 * @param budget memory for received messages in byte.
+	 */
+	ReliableBox(MessageBox<T>& box,
+				const void* preamble,
+				uint8_t address,
+				uint8_t window=8,
+				uint32_t timeout=200,
+				uint32_t budget=MESSAGE_FIFO_BUDGET);
+
+	/**
+	 * @brief Destructor, stops the service thread
+	 */
+	~ReliableBox();
+
+
+	/**
+	 * @brief Send a message reliably
+	 *
+	 * Returns when the message is transmitted once. Waits while the window
+	 * is full.
+	 * @param [in] destination Receiver's address.
+	 * @param [in] payload message need to be sent.
+	 * @param [in] len length of message, up to RELIABLE_DATA_SIZE.
+	 * @param [in] timeout maximum waiting time for the window in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int send(uint8_t destination, const void* payload, uint32_t len, int timeout=-1);
+
+
+	/**
+	 * @brief Pop the oldest message, waiting until one is available
+	 *
+	 * Messages of each source are popped in the order they were sent.
+	 * @param message Message instance;
+	 * @param timeout maximum waiting time in milliseconds, -1: forever.
+	 * @return 0: success, -1: timeout or failed.
+	 */
+	int pop(Message_t &message, int timeout);
+
+
+	/**
+	 * @brief Get the file descriptor signalling new messages
+	 * @return eventfd file descriptor.
+	 */
+	int getEventFd();
+
+
+	/**
+	 * @brief Get the number of retransmitted frames
+	 * @return the number of frames.
+	 */
+	uint32_t getRetransmissions();
+
+
+	/**
+	 * @brief Get the number of messages dropped after RELIABLE_MAX_RETRIES
+	 * @return the number of messages.
+	 */
+	uint32_t getFailures();
+
+
+private:
+
+	/**
+	 * @brief Struct containing a message in flight
+	 */
+	struct Outgoing_t {
+		bool active; /**< @brief waiting for acknowledgement */
+		uint8_t destination; /**< @brief destination address */
+		uint8_t sequence; /**< @brief sequence number */
+		uint8_t retries; /**< @brief number of retransmissions */
+		uint64_t deadline; /**< @brief time of the next retransmission in ns, see monotonicTime() */
+		uint32_t length; /**< @brief length of frame payload */
+		uint8_t payload[MESSAGE_MAX_PAYLOAD_SIZE]; /**< @brief header and data */
+	};
+
+	/**
+	 * @brief Struct containing a message received out of order
+	 */
+	struct Incoming_t {
+		bool active; /**< @brief slot in use */
+		uint8_t source; /**< @brief source address */
+		uint8_t sequence; /**< @brief sequence number */
+		uint32_t length; /**< @brief length of data */
+		uint8_t data[RELIABLE_DATA_SIZE]; /**< @brief data */
+	};
+
+	/**
+	 * @brief Struct containing receiving state of one source
+	 */
+	struct Peer_t {
+		bool known; /**< @brief a sequence was started and is followed */
+		bool started; /**< @brief a sequence was started before, expected is a lower bound */
+		bool ackPending; /**< @brief an acknowledgement is due */
+		bool resyncPending; /**< @brief a resync request is due */
+		uint8_t expected; /**< @brief next sequence number to deliver */
+		uint8_t syncSequence; /**< @brief sequence number of the last SYNC */
+		uint16_t session; /**< @brief session of the last SYNC */
+		uint8_t resyncSequence; /**< @brief start of the requested sequence */
+	};
+
+	/**
+	 * @brief Handle frames received by Message Box, then due acknowledgements
+	 * and retransmissions
+	 * @return time in milliseconds until the next retransmission, -1: none.
+	 */
+	int service();
+
+	/**
+	 * @brief Handle an acknowledgement
+	 * @param source Receiver's address.
+	 * @param next next expected sequence number.
+	 * @param map messages received after next.
+	 * @return nothing.
+	 */
+	void acknowledge(uint8_t source, uint8_t next, uint32_t map);
+
+	/**
+	 * @brief Handle a resync request, the messages in flight to the receiver
+	 * are numbered again from start and sent with SYNC on the oldest
+	 * @param source Receiver's address.
+	 * @param start first sequence number.
+	 * @return nothing.
+	 */
+	void resync(uint8_t source, uint8_t start);
+
+	/**
+	 * @brief Handle a data frame
+	 * @param source Transmitter's address.
+	 * @param control control flags.
+	 * @param sequence sequence number.
+	 * @param session session of the transmitter.
+	 * @param data data of the message.
+	 * @param len length of data.
+	 * @return nothing.
+	 */
+	void accept(uint8_t source, uint8_t control, uint8_t sequence, uint16_t session,
+				const uint8_t *data, uint32_t len);
+
+	/**
+	 * @brief Queue a message for pop()
+	 * @return 0: success, -1: FIFO is full.
+	 */
+	int deliver(uint8_t source, const uint8_t *data, uint32_t len);
+
+	/**
+	 * @brief Deliver messages of a source which are now in order
+	 * @param source Transmitter's address.
+	 * @return nothing.
+	 */
+	void release(uint8_t source);
+
+	/**
+	 * @brief Transmit an acknowledgement, or a resync request if the sequence
+	 * of the source is not known
+	 * @param destination Transmitter's address of the acknowledged messages.
+	 * @return nothing.
+	 */
+	void sendAck(uint8_t destination);
+
+	/**
+	 * @brief Drop all messages in flight to a destination
+	 * @param destination Receiver's address.
+	 * @return nothing.
+	 */
+	void reset(uint8_t destination);
+
+	static void* serviceThread(void *arg);
+
+	MessageBox<T>& box; /**< Message Box carrying the frames */
+
+	uint8_t preamble[MESSAGE_PREAMBLE_SIZE]; /**< preamble of sent packets */
+	uint8_t address; /**< local address */
+	uint16_t session; /**< random number sent in every header */
+	uint8_t window; /**< maximum number of messages in flight */
+	uint64_t timeout; /**< retransmission timeout in nanoseconds */
+
+	Outgoing_t *outgoing; /**< messages in flight */
+	uint8_t nextSequence[256]; /**< next sequence number per destination */
+	bool synced[256]; /**< a sequence was started per destination */
+	bool resyncing[256]; /**< a resync request was answered, the receiver has not acknowledged yet */
+
+	Incoming_t *incoming; /**< messages received out of order */
+	Peer_t peers[256]; /**< receiving state per source */
+
+	MessageQueue FIFO; /**< messages ready for pop() */
+
+	pthread_mutex_t lock; /**< protects sending state and transmission */
+	pthread_cond_t space; /**< signalled when a window slot is freed */
+
+	uint32_t retransmissions; /**< number of retransmitted frames */
+	uint32_t failures; /**< number of dropped messages */
+
+	std::atomic<bool> stalled; /**< a message waits for space in FIFO */
+	bool stopping; /**< service thread is asked to stop */
+	int wakeupfd; /**< eventfd used to wake up the service thread */
+	pthread_t thread; /**< service thread ID */
+	bool threadRunning; /**< state of thread, running or not */
+};
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#include "reliable_impl.h"
+
+#endif /* __RELIABLE__ */
@@ -0,0 +1,670 @@
+/**
+ * @file reliable_impl.h
+ * @brief Implementations for reliable, in-order delivery of messages
+ *
+ * It is included by reliable.h, so ReliableBox works with any transport.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 6, 2020
+ */
+
+#ifndef __RELIABLE_IMPL__
+#define __RELIABLE_IMPL__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "reliable.h"
+
+namespace eLinux {
+inline namespace MESSAGE_CONFIG {
+
+static_assert(MESSAGE_MAX_PAYLOAD_SIZE >= sizeof(ReliableHeader_t) + sizeof(uint32_t),
+				"payload is too small for acknowledgements");
+
+
+template <MESSAGE_TRANSPORT T>
+ReliableBox<T>::ReliableBox(MessageBox<T>& _box,
+							const void* preamble,
+							uint8_t address,
+							uint8_t window,
+							uint32_t timeout,
+							uint32_t budget):
+	box{_box},
+	FIFO(budget)
+{
+	memcpy(this->preamble, preamble, MESSAGE_PREAMBLE_SIZE);
+	this->address = address;
+	this->window = (window == 0) ? 1 : (window > RELIABLE_MAX_WINDOW) ? RELIABLE_MAX_WINDOW : window;
+	this->timeout = (uint64_t)timeout * 1000000ULL;
+	this->retransmissions = 0;
+	this->failures = 0;
+	this->stalled = false;
+	this->stopping = false;
+
+	this->outgoing = new Outgoing_t[this->window];
+	this->incoming = new Incoming_t[this->window];
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		this->outgoing[i].active = false;
+		this->incoming[i].active = false;
+	}
+
+	// a restarted node starts at another sequence number, in another session
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	unsigned int seed = now.tv_sec ^ now.tv_nsec;
+	uint8_t sequence = rand_r(&seed);
+
+	this->session = rand_r(&seed);
+
+	for (int i = 0; i < 256; i++) {
+		this->nextSequence[i] = sequence;
+		this->synced[i] = false;
+		this->resyncing[i] = false;
+		this->peers[i].known = false;
+		this->peers[i].started = false;
+		this->peers[i].ackPending = false;
+		this->peers[i].resyncPending = false;
+	}
+
+	pthread_mutex_init(&this->lock, NULL);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&this->space, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if ((this->wakeupfd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		perror("ReliableBox: Failed to create eventfd");
+	}
+
+	this->threadRunning = (pthread_create(&this->thread, NULL, serviceThread, this) == 0);
+
+	if (!this->threadRunning) {
+		perror("ReliableBox: Failed to create thread");
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+ReliableBox<T>::~ReliableBox() {
+	if (this->threadRunning) {
+		uint64_t value = 1;
+
+		pthread_mutex_lock(&this->lock);
+		this->stopping = true;
+		pthread_mutex_unlock(&this->lock);
+
+		if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+			perror("ReliableBox: Failed to wake up thread");
+		}
+
+		pthread_join(this->thread, NULL);
+	}
+
+	::close(this->wakeupfd);
+
+	pthread_cond_destroy(&this->space);
+	pthread_mutex_destroy(&this->lock);
+
+	delete[] this->incoming;
+	delete[] this->outgoing;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int ReliableBox<T>::send(uint8_t destination, const void* payload, uint32_t len, int timeout) {
+	if (len > RELIABLE_DATA_SIZE) {
+		return -1;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	if (timeout > 0) {
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (timeout % 1000) * 1000000L;
+
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&this->lock);
+
+	Outgoing_t *slot = NULL;
+	bool idle;
+
+	while (1) {
+		idle = true;
+
+		for (uint8_t i = 0; i < this->window; i++) {
+			if (this->outgoing[i].active) {
+				idle = false;
+			}
+			else if (slot == NULL) {
+				slot = &this->outgoing[i];
+			}
+		}
+
+		if (slot) {
+			break;
+		}
+
+		int ret = (timeout < 0) ? pthread_cond_wait(&this->space, &this->lock)
+								: pthread_cond_timedwait(&this->space, &this->lock, &deadline);
+
+		if (ret == ETIMEDOUT) {
+			pthread_mutex_unlock(&this->lock);
+			return -1;
+		}
+	}
+
+	ReliableHeader_t header;
+
+	header.control = RELIABLE_DATA | (this->synced[destination] ? 0 : RELIABLE_SYNC);
+	header.sequence = this->nextSequence[destination]++;
+	header.session = this->session;
+	this->synced[destination] = true;
+
+	memcpy(slot->payload, &header, sizeof(header));
+	memcpy(slot->payload + sizeof(header), payload, len);
+
+	slot->active = true;
+	slot->destination = destination;
+	slot->sequence = header.sequence;
+	slot->retries = 0;
+	slot->length = sizeof(header) + len;
+	slot->deadline = monotonicTime() + this->timeout;
+
+	// a failed write is repaired by retransmission
+	this->box.send(this->preamble, destination, this->address, slot->payload, slot->length);
+
+	// with nothing in flight the service thread has no retransmission timer
+	if (idle) {
+		uint64_t value = 1;
+
+		if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+			perror("ReliableBox: Failed to wake up thread");
+		}
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int ReliableBox<T>::pop(Message_t &message, int timeout) {
+	if (this->FIFO.wait(timeout) < 0 || this->FIFO.pop(message) < 0) {
+		return -1;
+	}
+
+	// messages held back for space can go now
+	if (this->stalled.exchange(false)) {
+		uint64_t value = 1;
+
+		if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+			perror("ReliableBox: Failed to wake up thread");
+		}
+	}
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int ReliableBox<T>::getEventFd() {
+	return this->FIFO.getEventFd();
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t ReliableBox<T>::getRetransmissions() {
+	pthread_mutex_lock(&this->lock);
+	uint32_t n = this->retransmissions;
+	pthread_mutex_unlock(&this->lock);
+
+	return n;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+uint32_t ReliableBox<T>::getFailures() {
+	pthread_mutex_lock(&this->lock);
+	uint32_t n = this->failures;
+	pthread_mutex_unlock(&this->lock);
+
+	return n;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int ReliableBox<T>::service() {
+	MessageView_t message;
+	ReliableHeader_t header;
+
+	while (this->box.peek(message) == 0) {
+		if (message.payloadSize >= sizeof(header)) {
+			memcpy(&header, message.payload, sizeof(header));
+
+			const uint8_t *data = message.payload + sizeof(header);
+			uint32_t len = message.payloadSize - sizeof(header);
+
+			if ((header.control & RELIABLE_ACK) && len >= sizeof(uint32_t)) {
+				uint32_t map;
+
+				memcpy(&map, data, sizeof(map));
+
+				pthread_mutex_lock(&this->lock);
+
+				if (header.control & RELIABLE_SYNC) {
+					resync(message.address, header.sequence);
+				}
+				else {
+					acknowledge(message.address, header.sequence, map);
+				}
+
+				pthread_mutex_unlock(&this->lock);
+			}
+			else if (header.control & RELIABLE_DATA) {
+				accept(message.address, header.control, header.sequence, header.session, data, len);
+			}
+		}
+
+		this->box.consume();
+	}
+
+	// messages held back while FIFO was full
+	for (uint8_t i = 0; i < this->window; i++) {
+		if (this->incoming[i].active) {
+			release(this->incoming[i].source);
+		}
+	}
+
+	pthread_mutex_lock(&this->lock);
+
+	// one acknowledgement per source answers a whole burst
+	for (int i = 0; i < 256; i++) {
+		if (this->peers[i].ackPending || this->peers[i].resyncPending) {
+			sendAck(i);
+		}
+	}
+
+	uint64_t now = monotonicTime();
+	uint64_t next = 0;
+	bool pending = false;
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		Outgoing_t *slot = &this->outgoing[i];
+
+		if (!slot->active) {
+			continue;
+		}
+
+		if (slot->deadline <= now) {
+			// the receiver is gone, start a new sequence later
+			if (slot->retries == RELIABLE_MAX_RETRIES) {
+				reset(slot->destination);
+				continue;
+			}
+
+			slot->retries++;
+			slot->deadline = now + this->timeout;
+			this->retransmissions++;
+
+			this->box.send(this->preamble, slot->destination, this->address,
+							slot->payload, slot->length);
+		}
+
+		if (!pending || slot->deadline - now < next) {
+			next = slot->deadline - now;
+			pending = true;
+		}
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	// in milliseconds for poll(), rounded up so the deadline has passed
+	return pending ? (int)((next + 999999) / 1000000) : -1;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::acknowledge(uint8_t source, uint8_t next, uint32_t map) {
+	uint64_t now = monotonicTime();
+	bool freed = false;
+
+	// the receiver follows the sequence again
+	this->resyncing[source] = false;
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		Outgoing_t *slot = &this->outgoing[i];
+
+		if (!slot->active || slot->destination != source) {
+			continue;
+		}
+
+		uint8_t offset = slot->sequence - next;
+
+		if ((int8_t)offset < 0) {
+			// cumulatively acknowledged
+			slot->active = false;
+			freed = true;
+		}
+		else if (offset >= 1 && offset <= 32 && (map >> (offset - 1)) & 1) {
+			// held by the receiver, not retransmitted while the gap is repaired
+			slot->retries = 0;
+			slot->deadline = now + this->timeout;
+		}
+	}
+
+	if (freed) {
+		pthread_cond_broadcast(&this->space);
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::resync(uint8_t source, uint8_t start) {
+	Outgoing_t *order[RELIABLE_MAX_WINDOW];
+	uint8_t count = 0;
+
+	// requests sent before the receiver saw the first answer are stale
+	if (this->resyncing[source]) {
+		return;
+	}
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		Outgoing_t *slot = &this->outgoing[i];
+
+		if (!slot->active || slot->destination != source) {
+			continue;
+		}
+
+		// oldest first: the farthest behind the next sequence number
+		uint8_t age = this->nextSequence[source] - slot->sequence;
+		uint8_t k = count++;
+
+		while (k > 0 && (uint8_t)(this->nextSequence[source] - order[k - 1]->sequence) < age) {
+			order[k] = order[k - 1];
+			k--;
+		}
+
+		order[k] = slot;
+	}
+
+	// the next message starts the sequence
+	if (count == 0) {
+		this->synced[source] = false;
+		return;
+	}
+
+	uint64_t now = monotonicTime();
+
+	for (uint8_t k = 0; k < count; k++) {
+		Outgoing_t *slot = order[k];
+		ReliableHeader_t header;
+
+		header.control = RELIABLE_DATA | (k == 0 ? RELIABLE_SYNC : 0);
+		header.sequence = start + k;
+		header.session = this->session;
+		memcpy(slot->payload, &header, sizeof(header));
+
+		slot->sequence = header.sequence;
+		slot->retries = 0;
+		slot->deadline = now + this->timeout;
+
+		this->box.send(this->preamble, source, this->address, slot->payload, slot->length);
+	}
+
+	this->nextSequence[source] = start + count;
+	this->synced[source] = true;
+	this->resyncing[source] = true;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::accept(uint8_t source, uint8_t control, uint8_t sequence, uint16_t session,
+							const uint8_t *data, uint32_t len)
+{
+	Peer_t *peer = &this->peers[source];
+
+	// a new sequence, unless it is a retransmitted SYNC
+	if ((control & RELIABLE_SYNC)
+		&& !(peer->known && sequence == peer->syncSequence && session == peer->session)) {
+		// delivered messages are never passed again, the sender starts anew after them
+		if (peer->started && (int8_t)(sequence - peer->expected) < 0) {
+			peer->known = false;
+			peer->ackPending = false;
+			peer->resyncPending = true;
+			peer->resyncSequence = peer->expected;
+			return;
+		}
+
+		peer->known = true;
+		peer->started = true;
+		peer->resyncPending = false;
+		peer->expected = sequence;
+		peer->syncSequence = sequence;
+		peer->session = session;
+
+		for (uint8_t i = 0; i < this->window; i++) {
+			if (this->incoming[i].source == source) {
+				this->incoming[i].active = false;
+			}
+		}
+	}
+
+	// the SYNC was lost or this node restarted, the sender is asked to start again
+	if (!peer->known) {
+		if (!peer->resyncPending) {
+			peer->resyncPending = true;
+			peer->resyncSequence = peer->started ? peer->expected : sequence;
+		}
+
+		return;
+	}
+
+	peer->ackPending = true;
+
+	uint8_t offset = sequence - peer->expected;
+
+	// duplicate, or too far ahead to be acknowledged
+	if ((int8_t)offset < 0 || offset > 32) {
+		return;
+	}
+
+	if (offset == 0 && deliver(source, data, len) == 0) {
+		peer->expected++;
+		release(source);
+		return;
+	}
+
+	Incoming_t *slot = NULL;
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		Incoming_t *s = &this->incoming[i];
+
+		if (s->active && s->source == source && s->sequence == sequence) {
+			return;
+		}
+
+		if (!s->active && slot == NULL) {
+			slot = s;
+		}
+	}
+
+	// without a free slot the message is retransmitted later
+	if (slot) {
+		slot->active = true;
+		slot->source = source;
+		slot->sequence = sequence;
+		slot->length = len;
+		memcpy(slot->data, data, len);
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+int ReliableBox<T>::deliver(uint8_t source, const uint8_t *data, uint32_t len) {
+	Message_t *slot = this->FIFO.reserve(len);
+
+	if (slot == NULL) {
+		this->stalled = true;
+		return -1;
+	}
+
+	slot->address = source;
+	slot->payloadSize = len;
+	memcpy(slot->payload, data, len);
+	this->FIFO.commit();
+
+	return 0;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::release(uint8_t source) {
+	Peer_t *peer = &this->peers[source];
+	bool found = true;
+
+	while (found) {
+		found = false;
+
+		for (uint8_t i = 0; i < this->window; i++) {
+			Incoming_t *slot = &this->incoming[i];
+
+			if (slot->active && slot->source == source && slot->sequence == peer->expected) {
+				if (deliver(source, slot->data, slot->length) < 0) {
+					return;
+				}
+
+				slot->active = false;
+				peer->expected++;
+				peer->ackPending = true;
+				found = true;
+			}
+		}
+	}
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::sendAck(uint8_t destination) {
+	Peer_t *peer = &this->peers[destination];
+	uint8_t payload[sizeof(ReliableHeader_t) + sizeof(uint32_t)];
+	ReliableHeader_t header;
+	uint32_t map = 0;
+
+	header.session = this->session;
+
+	if (!peer->known) {
+		header.control = RELIABLE_ACK | RELIABLE_SYNC;
+		header.sequence = peer->resyncSequence;
+
+		memcpy(payload, &header, sizeof(header));
+		memcpy(payload + sizeof(header), &map, sizeof(map));
+
+		this->box.send(this->preamble, destination, this->address, payload, sizeof(payload));
+		peer->ackPending = false;
+		peer->resyncPending = false;
+
+		return;
+	}
+
+	for (uint8_t i = 0; i < this->window; i++) {
+		Incoming_t *slot = &this->incoming[i];
+		uint8_t offset = slot->sequence - peer->expected;
+
+		if (slot->active && slot->source == destination && offset >= 1 && offset <= 32) {
+			map |= 1UL << (offset - 1);
+		}
+	}
+
+	header.control = RELIABLE_ACK;
+	header.sequence = peer->expected;
+
+	memcpy(payload, &header, sizeof(header));
+	memcpy(payload + sizeof(header), &map, sizeof(map));
+
+	this->box.send(this->preamble, destination, this->address, payload, sizeof(payload));
+	peer->ackPending = false;
+	peer->resyncPending = false;
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void ReliableBox<T>::reset(uint8_t destination) {
+	for (uint8_t i = 0; i < this->window; i++) {
+		Outgoing_t *slot = &this->outgoing[i];
+
+		if (slot->active && slot->destination == destination) {
+			slot->active = false;
+			this->failures++;
+		}
+	}
+
+	this->synced[destination] = false;
+	this->resyncing[destination] = false;
+	pthread_cond_broadcast(&this->space);
+}
+
+
+template <MESSAGE_TRANSPORT T>
+void* ReliableBox<T>::serviceThread(void *arg) {
+	ReliableBox<T> *reliable = static_cast<ReliableBox<T>*>(arg);
+	struct pollfd fds[2];
+	int timeout = -1;
+
+	fds[0].fd = reliable->box.getEventFd();
+	fds[0].events = POLLIN;
+	fds[1].fd = reliable->wakeupfd;
+	fds[1].events = POLLIN;
+
+	while (1) {
+		if (poll(fds, 2, timeout) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("ReliableBox: Failed to poll");
+			break;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			uint64_t value;
+
+			if (::read(reliable->wakeupfd, &value, sizeof(value)) < 0) {
+				perror("ReliableBox: Failed to reset eventfd");
+			}
+
+			pthread_mutex_lock(&reliable->lock);
+			bool stopping = reliable->stopping;
+			pthread_mutex_unlock(&reliable->lock);
+
+			if (stopping) {
+				break;
+			}
+		}
+
+		timeout = reliable->service();
+	}
+
+	return NULL;
+}
+
+} /* namespace MESSAGE_CONFIG */
+} /* namespace eLinux */
+
+#endif /* __RELIABLE_IMPL__ */
\ No newline at end of file
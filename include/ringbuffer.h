@@ -0,0 +1,216 @@
+/** 
+ * @file ringbuffer.h
+ * @brief Lock-free ring buffer
+ *
+ * SharedRingBuffer: any number of threads may push while one thread pops.
+ * It works without locking and without allocating memory. Items are
+ * stored in place.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 22, 2020
+ */
+
+
+#ifndef __RINGBUFFER__
+#define __RINGBUFFER__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+
+/** 
+ * @brief size of one cache line in byte
+ */
+#define RINGBUFFER_CACHE_LINE	64
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+
+
+/**
+ * @brief class SharedRingBuffer with fixed capacity, for many producers
+ * and one consumer
+ *
+ * Each slot carries a sequence number, which tells whether it is free,
+ * being filled or ready. Producers claim slots with one compare-and-swap
+ * and fill them concurrently; the consumer sees them in claimed order.
+ * @tparam T type of item;
+ * @tparam N capacity, must be a power of 2.
+ */
+template <class T, uint32_t N>
+class SharedRingBuffer {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of 2");
+
+public:
+
+	/**
+	 * @brief Constructor
+	 */
+	SharedRingBuffer(): head(0), tail(0) {
+		for (uint32_t i = 0; i < N; i++) {
+			this->slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+
+	/**
+	 * @brief Append an item, called by any producer
+	 * @param item new item.
+	 * @return true: OK, false: buffer is full.
+	 */
+	bool push(const T& item) {
+		uint32_t position;
+		T *slot = back(position);
+
+		if (slot == NULL) {
+			return false;
+		}
+
+		*slot = item;
+		commit(position);
+
+		return true;
+	}
+
+
+	/**
+	 * @brief Claim a free slot, called by any producer
+	 *
+	 * The slot becomes visible to the consumer after commit(). Until then
+	 * the consumer waits for it, so it must be filled without blocking.
+	 * @param position position of the slot, passed to commit().
+	 * @return pointer to the slot, NULL: buffer is full.
+	 */
+	T* back(uint32_t &position) {
+		uint32_t t = this->tail.load(std::memory_order_relaxed);
+
+		for (;;) {
+			Slot *slot = &this->slots[t & (N - 1)];
+			int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - t);
+
+			if (diff == 0) {
+				// on failure t is reloaded
+				if (this->tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+					position = t;
+					return &slot->item;
+				}
+			}
+			else if (diff < 0) {
+				return NULL;
+			}
+			else {
+				t = this->tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+
+	/**
+	 * @brief Publish the slot returned by back(), called by its producer
+	 * @param position position of the slot.
+	 * @return nothing.
+	 */
+	void commit(uint32_t position) {
+		this->slots[position & (N - 1)].sequence.store(position + 1, std::memory_order_release);
+	}
+
+
+	/**
+	 * @brief Remove the oldest item, called by the consumer only
+	 * @param item destination of the oldest item.
+	 * @return true: OK, false: buffer is empty.
+	 */
+	bool pop(T& item) {
+		T *slot = front();
+
+		if (slot == NULL) {
+			return false;
+		}
+
+		item = *slot;
+		drop();
+
+		return true;
+	}
+
+
+	/**
+	 * @brief Get the oldest item without removing it, called by the consumer only
+	 * @return pointer to the oldest item, NULL: buffer is empty or the
+	 * oldest slot is still being filled.
+	 */
+	T* front() {
+		uint32_t h = this->head.load(std::memory_order_relaxed);
+		Slot *slot = &this->slots[h & (N - 1)];
+
+		if (slot->sequence.load(std::memory_order_acquire) != h + 1) {
+			return NULL;
+		}
+
+		return &slot->item;
+	}
+
+
+	/**
+	 * @brief Release the item returned by front(), called by the consumer only
+	 * @return nothing.
+	 */
+	void drop() {
+		uint32_t h = this->head.load(std::memory_order_relaxed);
+
+		// the slot is free again one lap later
+		this->slots[h & (N - 1)].sequence.store(h + N, std::memory_order_release);
+		this->head.store(h + 1, std::memory_order_release);
+	}
+
+
+	/**
+	 * @brief Check if the buffer is empty, claimed slots count as items
+	 * @return true/false.
+	 */
+	bool empty() const {
+		return this->head.load(std::memory_order_acquire) 
+				== this->tail.load(std::memory_order_acquire);
+	}
+
+
+	/**
+	 * @brief Get the capacity of the buffer
+	 * @return the maximum number of items.
+	 */
+	static uint32_t capacity() {
+		return N;
+	}
+
+
+private:
+
+	/** 
+	 * @brief storage of one item
+	 */
+	struct Slot {
+		std::atomic<uint32_t> sequence; /**< position + 1: ready, position: free */
+		T item; /**< the item */
+	};
+
+	/** 
+	 * @brief index of the oldest item, written by the consumer
+	 */
+	std::atomic<uint32_t> head;
+	uint8_t headPadding[RINGBUFFER_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+
+	/** 
+	 * @brief index after the newest claimed slot, written by the producers
+	 */
+	std::atomic<uint32_t> tail;
+	uint8_t tailPadding[RINGBUFFER_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+
+	Slot slots[N]; /**< storage of items */
+};
+
+} /* namespace eLinux */
+
+#endif /* __RINGBUFFER__ */
@@ -0,0 +1,74 @@
+/**
+ * @file rs.h
+ * @brief Function prototypes for Reed-Solomon error correction over GF(256)
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date 2020 Feb 08
+ */
+
+
+#ifndef __RS__
+#define __RS__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+/**
+ * @brief maximum number of parity bytes per block
+ */
+#define RS_MAX_PARITY	32
+
+
+/**
+ * @brief maximum length of one block, data and parity, in byte
+ */
+#define RS_MAX_BLOCK	255
+
+
+/**
+ * @brief Reed-Solomon code with a fixed number of parity bytes
+ */
+typedef struct {
+	uint8_t parity; /**< number of parity bytes, corrects parity/2 byte errors */
+	uint8_t generator[RS_MAX_PARITY + 1]; /**< generator polynomial */
+} rs_codec_t;
+
+
+/**
+ * @brief prepare a code.
+ * @param codec the code.
+ * @param parity number of parity bytes, even, up to RS_MAX_PARITY.
+ * @return 0: OK, -1: invalid parity.
+ */
+int rs_init(rs_codec_t *codec, uint8_t parity);
+
+
+/**
+ * @brief compute the parity bytes of a block.
+ * @param codec the code.
+ * @param data data of the block.
+ * @param len length of data, up to RS_MAX_BLOCK - parity.
+ * @param parity output, codec->parity bytes.
+ * @return nothing.
+ */
+void rs_encode(const rs_codec_t *codec, const uint8_t *data, uint32_t len, uint8_t *parity);
+
+
+/**
+ * @brief correct a block in place.
+ * @param codec the code.
+ * @param block data followed by parity.
+ * @param len length of block, up to RS_MAX_BLOCK.
+ * @return number of corrected bytes, -1: too many errors.
+ */
+int rs_decode(const rs_codec_t *codec, uint8_t *block, uint32_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RS__ */
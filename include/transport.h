@@ -0,0 +1,219 @@
+/**
+ * @file transport.h
+ * @brief Requirements of a physical layer device used by MessageBox
+ *
+ * A transport is any class with these member functions:
+ * - int send(uint8_t data): transmit one byte, the number of bytes
+ *   written, -1: Error;
+ * - int sendBuffer(const void* data, uint32_t len): transmit a byte array,
+ *   the number of bytes written, -1: Error;
+ * - int receive(): get one byte;
+ * - int receiveBuffer(void* data, uint32_t len): get up to len bytes,
+ *   the number of bytes, -1: Error;
+ * - onReceiveData(CallbackType callback, void *arg): call callback(arg)
+ *   when data arrive, NULL: remove the callback.
+ *
+ * These are optional, a transport without them works with less:
+ * - int sendv(const struct iovec* vector, int count): the number of bytes
+ *   sent, fewer if the device failed meanwhile, -1: Error, else every
+ *   buffer goes through sendBuffer();
+ * - uint32_t getCharacterTime(): time of one character in ns, else 0;
+ * - int getOutputQueue(): bytes waiting for the line, else 0;
+ * - int drain(): wait until the line is idle, else nothing.
+ *
+ * The functions are called directly, they need not be virtual. With
+ * C++20 the requirements are also the concept MessageTransport, which
+ * constrains every template over a transport through MESSAGE_TRANSPORT.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 14, 2020
+ */
+
+
+#ifndef __TRANSPORT__
+#define __TRANSPORT__
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * @brief namespace eLinux
+ */
+namespace eLinux {
+
+
+/**
+ * @brief pointer type for callback function of incoming data
+ */
+typedef void (*CallbackType)(void*);
+
+
+/**
+ * @brief class Transport calls a physical layer device
+ * @tparam T the device.
+ */
+template <class T>
+class Transport {
+
+	template <class...> struct voider { typedef void type; };
+
+	template <class U, class = void>
+	struct hasSend : std::false_type {};
+
+	template <class U>
+	struct hasSend<U, typename voider<decltype(std::declval<U&>().send((uint8_t)0)),
+				decltype(std::declval<U&>().sendBuffer((const void*)0, (uint32_t)0))>::type>:
+		std::true_type {};
+
+	template <class U, class = void>
+	struct hasReceive : std::false_type {};
+
+	template <class U>
+	struct hasReceive<U, typename voider<decltype(std::declval<U&>().receive()),
+				decltype(std::declval<U&>().receiveBuffer((void*)0, (uint32_t)0)),
+				decltype(std::declval<U&>().onReceiveData((CallbackType)0, (void*)0))>::type>:
+		std::true_type {};
+
+	template <class U>
+	static auto sendv(U& device, const struct iovec* vector, int count, int)
+		-> decltype(device.sendv(vector, count))
+	{
+		return device.sendv(vector, count);
+	}
+
+	template <class U>
+	static int sendv(U& device, const struct iovec* vector, int count, long) {
+		int sent = 0;
+
+		for (int i = 0; i < count; i++) {
+			if (vector[i].iov_len == 0) {
+				continue;
+			}
+
+			int ret = device.sendBuffer(vector[i].iov_base, vector[i].iov_len);
+
+			if (ret < 0) {
+				return sent ? sent : -1;
+			}
+
+			sent += ret;
+
+			if ((uint32_t)ret < vector[i].iov_len) {
+				break;
+			}
+		}
+
+		return sent;
+	}
+
+	template <class U>
+	static auto getCharacterTime(U& device, int) -> decltype(device.getCharacterTime()) {
+		return device.getCharacterTime();
+	}
+
+	template <class U>
+	static uint32_t getCharacterTime(U& device, long) {
+		return 0;
+	}
+
+	template <class U>
+	static auto getOutputQueue(U& device, int) -> decltype(device.getOutputQueue()) {
+		return device.getOutputQueue();
+	}
+
+	template <class U>
+	static int getOutputQueue(U& device, long) {
+		return 0;
+	}
+
+	template <class U>
+	static auto drain(U& device, int) -> decltype(device.drain()) {
+		return device.drain();
+	}
+
+	template <class U>
+	static int drain(U& device, long) {
+		return 0;
+	}
+
+public:
+
+	/**
+	 * @brief true if T has the required member functions
+	 */
+	static const bool valid = hasSend<T>::value && hasReceive<T>::value;
+
+
+	/**
+	 * @brief Transmit several byte arrays
+	 * @param device the device;
+	 * @param vector array of buffers;
+	 * @param count the number of buffers.
+	 * @return the number of bytes sent, less than the total if the device
+	 * failed meanwhile, -1: Error.
+	 */
+	static inline int sendv(T& device, const struct iovec* vector, int count) {
+		return sendv(device, vector, count, 0);
+	}
+
+
+	/**
+	 * @brief Get the time needed to transmit one character
+	 * @param device the device.
+	 * @return character time in nanoseconds, 0: unknown.
+	 */
+	static inline uint32_t getCharacterTime(T& device) {
+		return getCharacterTime(device, 0);
+	}
+
+
+	/**
+	 * @brief Get the number of bytes waiting for the line
+	 * @param device the device.
+	 * @return the number of bytes, 0: unknown, -1: Error.
+	 */
+	static inline int getOutputQueue(T& device) {
+		return getOutputQueue(device, 0);
+	}
+
+
+	/**
+	 * @brief Block until all queued output has been transmitted
+	 * @param device the device.
+	 * @return 0: OK, -1: Error.
+	 */
+	static inline int drain(T& device) {
+		return drain(device, 0);
+	}
+};
+
+
+#if defined(__cpp_concepts)
+/**
+ * @brief concept of a physical layer device used by MessageBox
+ */
+template <class T>
+concept MessageTransport = requires(T& device, uint8_t data, const void* input,
+									void* output, uint32_t len,
+									CallbackType callback, void* arg)
+{
+	device.send(data);
+	device.sendBuffer(input, len);
+	device.receive();
+	device.receiveBuffer(output, len);
+	device.onReceiveData(callback, arg);
+};
+
+/**
+ * @brief parameter kind of a transport in a template head
+ */
+#define MESSAGE_TRANSPORT	MessageTransport
+#else
+#define MESSAGE_TRANSPORT	class
+#endif
+
+} /* namespace eLinux */
+
+#endif /* __TRANSPORT__ */
@@ -10,6 +10,8 @@
 
 #include <string>
 #include <termios.h>
+#include <sys/uio.h>
+#include "reactor.h"
 
 /**
  * @brief Path to UART character files
@@ -22,12 +24,6 @@
 namespace BBB {
 
 
-/**
- * @brief pointer type for callback function
- */
-typedef void (*CallbackType)(void*);
-
-
 /**
  * @brief Class UART contains functions and variables
  * using for UART communication.
@@ -49,9 +45,11 @@ public:
 	 * @brief Constructor
 	 * @param bus UART bus number;
 	 * @param baudrate UART baudrate;
-	 * @param bit data size: 5,6,7 or 8 bit
+	 * @param bit data size: 5,6,7 or 8 bit;
+	 * @param reactor shared event loop for incoming data,
+	 * NULL: the UART runs its own event loop thread.
 	 */
-	UART(PORT bus, int baudrate=B9600, uint8_t bit=CS8);
+	UART(PORT bus, int baudrate=B9600, uint8_t bit=CS8, Reactor *reactor=NULL);
 
 
 	/**
@@ -63,25 +61,37 @@ public:
 	/**
 	 * @brief Transmit one byte via UART bus
 	 * @param data one byte data.
-	 * @return 0: OK, -1: Error.
+	 * @return the number of bytes written, -1: Error.
 	 */
-	virtual int send(uint8_t data);
+	int send(uint8_t data);
 
 
 	/**
  	 * @brief Transmit a byte array via UART bus
  	 * @param data pointer to data.
  	 * @param len the length of data in byte.
- 	 * @return 0: OK, -1: Error.
+ 	 * @return the number of bytes written, -1: Error.
  	 */
-	virtual int sendBuffer(const void* data, uint32_t len);
+	int sendBuffer(const void* data, uint32_t len);
+
+
+	/**
+ 	 * @brief Transmit several byte arrays via UART bus in one call
+ 	 *
+ 	 * Partial writes are resumed until every buffer has been sent.
+ 	 * @param vector array of buffers.
+ 	 * @param count the number of buffers.
+ 	 * @return the number of bytes sent, less than the total if the output
+ 	 * failed meanwhile, -1: Error.
+ 	 */
+	int sendv(const struct iovec* vector, int count);
 
 
 	/** 
 	 * @brief Get one byte from UART bus
 	 * @return one byte.
 	 */
-	virtual int receive();
+	int receive();
 
 
 	/** 
@@ -90,16 +100,39 @@ public:
 	 * @parem the number of bytes will be received.
 	 * @return 0: OK, -1: Error.
 	 */	
-	virtual int receiveBuffer(void* data, uint32_t len);
+	int receiveBuffer(void* data, uint32_t len);
 
 
 	/**
 	 * @brief Add callback for incoming data
-	 * @param callback callback function name;
+	 * @param callback callback function name, NULL: remove the callback;
 	 * @param arg argument of callback function.
 	 * @return nothing.
 	 */
-	virtual void onReceiveData(CallbackType callback, void *arg);
+	void onReceiveData(CallbackType callback, void *arg);
+
+
+	/**
+	 * @brief Get the time needed to transmit one character on the line
+	 *
+	 * One character is the start bit, the data bits and the stop bit.
+	 * @return character time in nanoseconds.
+	 */
+	uint32_t getCharacterTime();
+
+
+	/**
+	 * @brief Get the number of bytes waiting in the kernel output queue
+	 * @return the number of bytes, -1: Error.
+	 */
+	int getOutputQueue();
+
+
+	/**
+	 * @brief Block until all queued output has been transmitted
+	 * @return 0: OK, -1: Error.
+	 */
+	int drain();
 
 
 private:
@@ -111,17 +144,16 @@ private:
 	uint8_t datasize; /**< UART datasize */
 	PORT port; /**< UART bus number */
 
-	bool threadRunning; /**< state of thread, running or not */
-	CallbackType callbackFunction; /**< callback function on incoming data */
-	void* callbackArgument; /**< argument for callback function */
-	pthread_t thread; /**< thread ID */
-	
+	Reactor *reactor; /**< event loop serving incoming data */
+	bool ownReactor; /**< the event loop belongs to this UART */
+	bool registered; /**< the device file is registered with the event loop */
+
 
 	/**
-	 * @brief Polling for incoming data
+	 * @brief Block until the output can take more data
 	 * @return 0: OK, -1: Error.
 	 */
-	int waitData();
+	int waitWritable();
 
 
 	/** 
@@ -138,20 +170,8 @@ private:
 	 * @return nothing.
 	 */		
 	void close();
-
-
-	/**
-	 * @brief Friend function used for multi-threading
-	 * @param value void pointer to argument
-	 * @return NULL
-	 */
-	friend void *threadedPoll(void* arg);
-	
 };
 
-
-void *threadedPoll(void* arg);
-
 } /* namespace BBB */
 
 #endif /* __UART__ */
\ No newline at end of file
@@ -1,120 +1,499 @@
-/** 
- * @file crc32.c
- * @brief Function implementation for computing CRC-32 checksum.
- * @author Nguyen Trong Phuong (aka trongphuongpro)
- * @date 2019 Dec 28
- */
-
-
-#include <stdint.h>
-#include <stdlib.h>
-#include <string.h>
-#include "crc32.h"
-
-#define CRC32POLY			0x04C11DB7
-#define CRC32POLY_REVERSE	0xEDB88320
-
-
-static const crc32_t crc32Table[256] = {
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-	0xe963a535, 0x9e6495a3,	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-	0xf3b97148, 0x84be41de,	0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,	0x14015c4f, 0x63066cd9,
-	0xfa0f3d63, 0x8d080df5,	0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,	0x35b5a8fa, 0x42b2986c,
-	0xdbbbc9d6, 0xacbcf940,	0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-	0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,	0x76dc4190, 0x01db7106,
-	0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-	0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-	0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-	0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-	0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-	0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-	0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-	0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-	0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-	0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-	0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-	0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-	0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-	0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-	0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-	0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
-
-
-uint8_t reverse(uint8_t number) {
-	uint8_t result = 0;
-	for (uint8_t i = 0; i < 8; i++) {
-		result = (result << 1) + ((number >> i) & 1);
-	}
-	return result;
-}
-
-
-crc32_t crc32_compute(const void *data, uint32_t len) {
-	uint8_t *msg = (uint8_t*)data;
-	crc32_t remainder = 0xFFFFFFFF;
-	
-	for (uint32_t i = 0; i < len; i++) {
-		remainder = crc32Table[msg[i] ^ (remainder & 0xFF)] ^ (remainder >> 8);
-	}
-	
-	return ~remainder;
-}
-
-
-crc32_t crc32_concat(crc32_t checksum, const void* data, uint32_t len) {
-	uint8_t *msg = (uint8_t*)data;
-	checksum = ~checksum;
-
-	for (uint32_t i = 0; i < len; i++) {
-		checksum = crc32Table[msg[i] ^ (checksum & 0xFF)] ^ (checksum >> 8);
-	}
-
-	return ~checksum;
-}
-
-
-int crc32_selfcheck(const void *data, uint32_t len, crc32_t crc) {
-	uint8_t *msg = (uint8_t*)calloc(len + 4, 1);
-	crc = ~crc;
-
-	memcpy(msg, data, len);
-	memcpy(msg+len, &crc, 4);
-
-	int ret = crc32_check(msg, len+4);
-
-	free(msg);
-
-	return ret;
-}
-
-
-int crc32_check(const void *data, uint32_t len) {
-	crc32_t ret = ~crc32_compute(data, len);
-
-	if (ret == 0)
-		return 0;
-
-	return -1;
+/** 
+ * @file crc32.c
+ * @brief Function implementation for computing CRC-32 checksum.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date 2019 Dec 28
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "crc32.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#define CRC32_PCLMUL
+#endif
+
+/*
+ * The ARMv8 path is always built on AArch64. On 32-bit ARM the crc32
+ * instructions exist only from ARMv8 on, so it is built only when the
+ * compiler targets one (__ARM_FEATURE_CRC32, e.g. -march=armv8-a+crc,
+ * see MESSAGE_CRC32_ARMV8 in CMakeLists.txt); an ARMv7 build such as
+ * the BeagleBone one uses slicing-by-8.
+ */
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FEATURE_CRC32))
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#define CRC32_ARMV8
+#endif
+
+#define CRC32POLY			0x04C11DB7
+#define CRC32POLY_REVERSE	0xEDB88320
+
+/**
+ * @brief block size of crc32_copy, small enough to stay in L1 cache
+ */
+#define CRC32_COPY_BLOCK	256
+
+
+/**
+ * @brief update function working on the raw (not inverted) CRC register
+ */
+typedef crc32_t (*crc32_update_t)(crc32_t crc, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief the fastest update function, selected once by crc32_setup,
+ * read only through crc32_updater
+ */
+static crc32_update_t crc32Update;
+
+
+static const crc32_t crc32Table[256] = {
+	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+	0xe963a535, 0x9e6495a3,	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+	0xf3b97148, 0x84be41de,	0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,	0x14015c4f, 0x63066cd9,
+	0xfa0f3d63, 0x8d080df5,	0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,	0x35b5a8fa, 0x42b2986c,
+	0xdbbbc9d6, 0xacbcf940,	0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+	0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,	0x76dc4190, 0x01db7106,
+	0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+	0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+	0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+	0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+	0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+	0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+	0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+	0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+	0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+	0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+	0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+	0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+	0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+	0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+	0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+	0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+
+/**
+ * @brief tables for slicing-by-8, crc32Slices[0] is crc32Table
+ */
+static crc32_t crc32Slices[8][256];
+
+/**
+ * @brief x^(2^n) mod P, for n = 0..31, used by crc32_combine
+ */
+static crc32_t crc32PowerTable[32];
+
+static pthread_once_t crc32Once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief multiply a(x) by b(x) modulo P(x), in reflected bit order
+ */
+static crc32_t crc32_multiply(crc32_t a, crc32_t b) {
+	crc32_t m = (crc32_t)1 << 31;
+	crc32_t product = 0;
+
+	while (a) {
+		if (a & m) {
+			product ^= b;
+			a &= ~m;
+		}
+
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC32POLY_REVERSE : b >> 1;
+	}
+
+	return product;
+}
+
+
+/**
+ * @brief compute x^(n * 2^k) mod P(x)
+ */
+static crc32_t crc32_power(uint32_t n, uint32_t k) {
+	crc32_t p = (crc32_t)1 << 31; // x^0 == 1
+
+	while (n) {
+		if (n & 1) {
+			p = crc32_multiply(crc32PowerTable[k & 31], p);
+		}
+
+		n >>= 1;
+		k++;
+	}
+
+	return p;
+}
+
+
+/**
+ * @brief byte-at-a-time update
+ */
+static crc32_t crc32_update_table(crc32_t crc, const uint8_t *data, uint32_t len) {
+	while (len--) {
+		crc = crc32Table[*data++ ^ (crc & 0xFF)] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+
+/**
+ * @brief slicing-by-8 update, 8 bytes per step
+ */
+static crc32_t crc32_update_slice8(crc32_t crc, const uint8_t *data, uint32_t len) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	while (len >= 8) {
+		uint32_t low, high;
+
+		memcpy(&low, data, 4);
+		memcpy(&high, data + 4, 4);
+		low ^= crc;
+
+		crc = crc32Slices[7][low & 0xFF] ^ crc32Slices[6][(low >> 8) & 0xFF]
+			^ crc32Slices[5][(low >> 16) & 0xFF] ^ crc32Slices[4][low >> 24]
+			^ crc32Slices[3][high & 0xFF] ^ crc32Slices[2][(high >> 8) & 0xFF]
+			^ crc32Slices[1][(high >> 16) & 0xFF] ^ crc32Slices[0][high >> 24];
+
+		data += 8;
+		len -= 8;
+	}
+#endif
+
+	return crc32_update_table(crc, data, len);
+}
+
+
+#ifdef CRC32_ARMV8
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32		(1 << 7)
+#endif
+
+#ifndef HWCAP2_CRC32
+#define HWCAP2_CRC32	(1 << 4)
+#endif
+
+#if defined(__aarch64__) && !defined(__ARM_FEATURE_CRC32)
+#define CRC32_ARMV8_TARGET	__attribute__((target("+crc")))
+#else
+#define CRC32_ARMV8_TARGET
+#endif
+
+/**
+ * @brief update with ARMv8 crc32b/w/d instructions
+ */
+CRC32_ARMV8_TARGET
+static crc32_t crc32_update_armv8(crc32_t crc, const uint8_t *data, uint32_t len) {
+	while (len && ((uintptr_t)data & 7)) {
+		crc = __crc32b(crc, *data++);
+		len--;
+	}
+
+	while (len >= 8) {
+		uint64_t value;
+
+		memcpy(&value, data, 8);
+		crc = __crc32d(crc, value);
+		data += 8;
+		len -= 8;
+	}
+
+	while (len--) {
+		crc = __crc32b(crc, *data++);
+	}
+
+	return crc;
+}
+
+
+static int crc32_have_armv8(void) {
+#if defined(__aarch64__)
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+	return (getauxval(AT_HWCAP2) & HWCAP2_CRC32) != 0;
+#endif
+}
+
+#endif /* CRC32_ARMV8 */
+
+
+#ifdef CRC32_PCLMUL
+
+/**
+ * @brief folding constants x^(k) mod P for the reflected polynomial
+ */
+static const uint64_t crc32Fold1[2] __attribute__((aligned(16))) = {0x0154442bd4, 0x01c6e41596};
+static const uint64_t crc32Fold2[2] __attribute__((aligned(16))) = {0x01751997d0, 0x00ccaa009e};
+static const uint64_t crc32Fold3[2] __attribute__((aligned(16))) = {0x0163cd6124, 0x0000000000};
+static const uint64_t crc32Barrett[2] __attribute__((aligned(16))) = {0x01db710641, 0x01f7011641};
+
+
+/**
+ * @brief fold 64-byte blocks with carry-less multiplication
+ *
+ * len must be at least 64 and a multiple of 16.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static crc32_t crc32_fold_pclmul(crc32_t crc, const uint8_t *data, uint32_t len) {
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((const __m128i*)crc32Fold1);
+
+	data += 64;
+	len -= 64;
+
+	// fold 4 x 128 bits in parallel
+	while (len >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		y5 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+		y6 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+		y7 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+		y8 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+		data += 64;
+		len -= 64;
+	}
+
+	// fold into 128 bits
+	x0 = _mm_load_si128((const __m128i*)crc32Fold2);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// fold the remaining 16-byte blocks
+	while (len >= 16) {
+		x2 = _mm_loadu_si128((const __m128i*)data);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		data += 16;
+		len -= 16;
+	}
+
+	// fold 128 bits into 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i*)crc32Fold3);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i*)crc32Barrett);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
+}
+
+
+/**
+ * @brief update with PCLMULQDQ folding, short tails use slicing-by-8
+ */
+static crc32_t crc32_update_pclmul(crc32_t crc, const uint8_t *data, uint32_t len) {
+	if (len >= 64) {
+		uint32_t chunk = len & ~15U;
+
+		crc = crc32_fold_pclmul(crc, data, chunk);
+		data += chunk;
+		len -= chunk;
+	}
+
+	return crc32_update_slice8(crc, data, len);
+}
+
+#endif /* CRC32_PCLMUL */
+
+
+/**
+ * @brief build the slicing tables and select the update function
+ */
+static void crc32_setup(void) {
+	crc32_update_t update = crc32_update_slice8;
+
+	for (int i = 0; i < 256; i++) {
+		crc32Slices[0][i] = crc32Table[i];
+	}
+
+	crc32_t p = (crc32_t)1 << 30; // x^1
+
+	for (int n = 0; n < 32; n++) {
+		crc32PowerTable[n] = p;
+		p = crc32_multiply(p, p);
+	}
+
+	for (int k = 1; k < 8; k++) {
+		for (int i = 0; i < 256; i++) {
+			crc32_t crc = crc32Slices[k-1][i];
+			crc32Slices[k][i] = crc32Table[crc & 0xFF] ^ (crc >> 8);
+		}
+	}
+
+#ifdef CRC32_ARMV8
+	if (crc32_have_armv8()) {
+		update = crc32_update_armv8;
+	}
+#endif
+
+#ifdef CRC32_PCLMUL
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		update = crc32_update_pclmul;
+	}
+#endif
+
+	crc32Update = update;
+}
+
+
+/**
+ * @brief get the update function, every caller passes pthread_once,
+ * so the tables written by crc32_setup are visible to it
+ */
+static inline crc32_update_t crc32_updater(void) {
+	pthread_once(&crc32Once, crc32_setup);
+
+	return crc32Update;
+}
+
+
+uint8_t reverse(uint8_t number) {
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < 8; i++) {
+		result = (result << 1) + ((number >> i) & 1);
+	}
+	return result;
+}
+
+
+crc32_t crc32_compute(const void *data, uint32_t len) {
+	return ~crc32_updater()(0xFFFFFFFF, (const uint8_t*)data, len);
+}
+
+
+crc32_t crc32_concat(crc32_t checksum, const void* data, uint32_t len) {
+	return ~crc32_updater()(~checksum, (const uint8_t*)data, len);
+}
+
+
+crc32_t crc32_copy(crc32_t checksum, void* dst, const void* src, uint32_t len) {
+	crc32_update_t update = crc32_updater();
+	uint8_t *to = (uint8_t*)dst;
+	const uint8_t *from = (const uint8_t*)src;
+
+	checksum = ~checksum;
+
+	// checksum each block while it is still in cache from the copy
+	while (len) {
+		uint32_t block = (len > CRC32_COPY_BLOCK) ? CRC32_COPY_BLOCK : len;
+
+		memcpy(to, from, block);
+		checksum = update(checksum, to, block);
+
+		to += block;
+		from += block;
+		len -= block;
+	}
+
+	return ~checksum;
+}
+
+
+crc32_t crc32_combine(crc32_t checksumA, crc32_t checksumB, uint32_t lenB) {
+	pthread_once(&crc32Once, crc32_setup);
+
+	// shift checksumA over lenB zero bytes, i.e. multiply by x^(8*lenB)
+	return crc32_multiply(crc32_power(lenB, 3), checksumA) ^ checksumB;
+}
+
+
+int crc32_selfcheck(const void *data, uint32_t len, crc32_t crc) {
+	uint8_t residue[4];
+
+	// the same check as crc32_check() on data followed by ~crc
+	crc = ~crc;
+	memcpy(residue, &crc, 4);
+
+	if (~crc32_concat(crc32_compute(data, len), residue, 4) == 0)
+		return 0;
+
+	return -1;
+}
+
+
+int crc32_check(const void *data, uint32_t len) {
+	crc32_t ret = ~crc32_compute(data, len);
+
+	if (ret == 0)
+		return 0;
+
+	return -1;
 }
\ No newline at end of file
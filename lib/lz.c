@@ -0,0 +1,289 @@
+/**
+ * @file lz.c
+ * @brief Function implementation for a small LZ77 compressor.
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date 2020 Feb 10
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+
+#define LZ_MIN_MATCH		4
+#define LZ_MAX_OFFSET		0xFFFF
+
+/**
+ * @brief number of bits of the hash table over the input, kept small
+ * because it is cleared on every call
+ */
+#define LZ_LOCAL_BITS		8
+
+
+static inline uint32_t lz_read32(const uint8_t *p) {
+	uint32_t x;
+
+	memcpy(&x, p, sizeof(x));
+
+	return x;
+}
+
+
+static inline uint32_t lz_hash(uint32_t x, int bits) {
+	return (x * 2654435761U) >> (32 - bits);
+}
+
+
+/**
+ * @brief length of a match of input at position i with history at position p,
+ * where history is the dictionary followed by the input
+ */
+static uint32_t lz_extend(const lz_dictionary_t *dictionary, const uint8_t *in,
+						uint32_t len, uint32_t i, uint32_t p)
+{
+	uint32_t dictLen = dictionary ? dictionary->len : 0;
+	uint32_t n = 0;
+
+	while (i + n < len) {
+		uint32_t q = p + n;
+		uint8_t c = (q < dictLen) ? dictionary->data[q] : in[q - dictLen];
+
+		if (c != in[i + n]) {
+			break;
+		}
+
+		n++;
+	}
+
+	return n;
+}
+
+
+static uint8_t* lz_length(uint8_t *out, const uint8_t *end, uint32_t n) {
+	while (out < end && n >= 255) {
+		*out++ = 255;
+		n -= 255;
+	}
+
+	if (out == end) {
+		return NULL;
+	}
+
+	*out++ = n;
+
+	return out;
+}
+
+
+/**
+ * @brief write one sequence, match = 0 for the last one
+ * @return end of output, NULL: output is full.
+ */
+static uint8_t* lz_sequence(uint8_t *out, const uint8_t *end,
+							const uint8_t *literals, uint32_t count,
+							uint32_t offset, uint32_t match)
+{
+	uint32_t extra = match ? match - LZ_MIN_MATCH : 0;
+
+	if (out == end) {
+		return NULL;
+	}
+
+	*out++ = ((count < 15 ? count : 15) << 4) | (extra < 15 ? extra : 15);
+
+	if (count >= 15 && (out = lz_length(out, end, count - 15)) == NULL) {
+		return NULL;
+	}
+
+	if ((uint32_t)(end - out) < count) {
+		return NULL;
+	}
+
+	memcpy(out, literals, count);
+	out += count;
+
+	if (match == 0) {
+		return out;
+	}
+
+	if (end - out < 2) {
+		return NULL;
+	}
+
+	*out++ = offset & 0xFF;
+	*out++ = offset >> 8;
+
+	if (extra >= 15) {
+		out = lz_length(out, end, extra - 15);
+	}
+
+	return out;
+}
+
+
+void lz_dictionary(lz_dictionary_t *dictionary, const void *data, uint32_t len) {
+	const uint8_t *content = (const uint8_t*)data;
+
+	if (len > LZ_MAX_DICTIONARY) {
+		content += len - LZ_MAX_DICTIONARY;
+		len = LZ_MAX_DICTIONARY;
+	}
+
+	dictionary->data = content;
+	dictionary->len = len;
+	memset(dictionary->table, 0, sizeof(dictionary->table));
+
+	// later positions win, they are closer to the data
+	for (uint32_t i = 0; i + LZ_MIN_MATCH <= len; i++) {
+		dictionary->table[lz_hash(lz_read32(content + i), LZ_HASH_BITS)] = i + 1;
+	}
+}
+
+
+uint32_t lz_compress(const lz_dictionary_t *dictionary, const void *src, uint32_t len,
+						void *dst, uint32_t capacity)
+{
+	const uint8_t *in = (const uint8_t*)src;
+	uint8_t *out = (uint8_t*)dst;
+	const uint8_t *end = out + capacity;
+	uint32_t dictLen = dictionary ? dictionary->len : 0;
+	uint16_t local[1 << LZ_LOCAL_BITS];
+	uint32_t anchor = 0;
+	uint32_t i = 0;
+
+	memset(local, 0, sizeof(local));
+
+	while (i + LZ_MIN_MATCH <= len) {
+		uint32_t x = lz_read32(in + i);
+		uint32_t match = 0;
+		uint32_t offset = 0;
+		uint32_t h = lz_hash(x, LZ_LOCAL_BITS);
+		uint32_t candidate = local[h];
+
+		local[h] = (i < 0xFFFF) ? i + 1 : 0;
+
+		// earlier input
+		if (candidate && i - (candidate - 1) <= LZ_MAX_OFFSET) {
+			uint32_t n = lz_extend(dictionary, in, len, i, dictLen + candidate - 1);
+
+			if (n >= LZ_MIN_MATCH) {
+				match = n;
+				offset = i - (candidate - 1);
+			}
+		}
+
+		// dictionary
+		if (dictLen) {
+			candidate = dictionary->table[lz_hash(x, LZ_HASH_BITS)];
+
+			if (candidate && dictLen - (candidate - 1) + i <= LZ_MAX_OFFSET) {
+				uint32_t n = lz_extend(dictionary, in, len, i, candidate - 1);
+
+				if (n >= LZ_MIN_MATCH && n > match) {
+					match = n;
+					offset = dictLen - (candidate - 1) + i;
+				}
+			}
+		}
+
+		if (match == 0) {
+			i++;
+			continue;
+		}
+
+		out = lz_sequence(out, end, in + anchor, i - anchor, offset, match);
+
+		if (out == NULL) {
+			return 0;
+		}
+
+		i += match;
+		anchor = i;
+	}
+
+	out = lz_sequence(out, end, in + anchor, len - anchor, 0, 0);
+
+	if (out == NULL) {
+		return 0;
+	}
+
+	return out - (uint8_t*)dst;
+}
+
+
+int32_t lz_decompress(const lz_dictionary_t *dictionary, const void *src, uint32_t len,
+						void *dst, uint32_t capacity)
+{
+	const uint8_t *in = (const uint8_t*)src;
+	const uint8_t *inEnd = in + len;
+	uint8_t *out = (uint8_t*)dst;
+	uint32_t dictLen = dictionary ? dictionary->len : 0;
+	uint32_t o = 0;
+
+	while (in < inEnd) {
+		uint8_t token = *in++;
+		uint32_t count = token >> 4;
+		uint32_t match = token & 0x0F;
+
+		if (count == 15) {
+			uint8_t b;
+
+			do {
+				if (in >= inEnd) {
+					return -1;
+				}
+
+				b = *in++;
+				count += b;
+			} while (b == 255);
+		}
+
+		if ((uint32_t)(inEnd - in) < count || capacity - o < count) {
+			return -1;
+		}
+
+		memcpy(out + o, in, count);
+		in += count;
+		o += count;
+
+		// the last sequence has no match
+		if (in == inEnd) {
+			break;
+		}
+
+		if (inEnd - in < 2) {
+			return -1;
+		}
+
+		uint32_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		if (match == 15) {
+			uint8_t b;
+
+			do {
+				if (in >= inEnd) {
+					return -1;
+				}
+
+				b = *in++;
+				match += b;
+			} while (b == 255);
+		}
+
+		match += LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > o + dictLen || capacity - o < match) {
+			return -1;
+		}
+
+		// the history is the dictionary followed by the output
+		for (uint32_t n = 0; n < match; n++, o++) {
+			uint32_t p = o + dictLen - offset;
+
+			out[o] = (p < dictLen) ? dictionary->data[p] : out[p - dictLen];
+		}
+	}
+
+	return o;
+}
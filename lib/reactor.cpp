@@ -0,0 +1,207 @@
+/** 
+ * @file reactor.cpp
+ * @brief This file contains implementation for class Reactor - an event
+ * loop serving many file descriptors from one thread
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date January 20, 2020
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include "reactor.h"
+
+
+using namespace std;
+
+namespace BBB {
+
+Reactor::Reactor() {
+	this->threadRunning = false;
+	this->active = -1;
+
+	pthread_mutex_init(&this->lock, NULL);
+	pthread_cond_init(&this->finished, NULL);
+
+	if ((this->epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		perror("Reactor: Failed to create epollfd");
+	}
+
+	if ((this->wakeupfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		perror("Reactor: Failed to create eventfd");
+	}
+
+	struct epoll_event event;
+
+	event.events = EPOLLIN;
+	event.data.fd = this->wakeupfd;
+
+	if (epoll_ctl(this->epollfd, EPOLL_CTL_ADD, this->wakeupfd, &event) < 0) {
+		perror("Reactor: Failed to add wakeup interface");
+	}
+}
+
+
+Reactor::~Reactor() {
+	if (this->threadRunning) {
+		stop();
+	}
+
+	::close(this->wakeupfd);
+	::close(this->epollfd);
+
+	pthread_cond_destroy(&this->finished);
+	pthread_mutex_destroy(&this->lock);
+}
+
+
+int Reactor::add(int fd, CallbackType callback, void *arg, uint32_t events) {
+	struct epoll_event event;
+	int ret = 0;
+
+	event.events = events;
+	event.data.fd = fd;
+
+	pthread_mutex_lock(&this->lock);
+
+	if (epoll_ctl(this->epollfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		perror("Reactor: Failed to add control interface");
+		ret = -1;
+	}
+	else {
+		this->sources[fd].callback = callback;
+		this->sources[fd].arg = arg;
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	return ret;
+}
+
+
+int Reactor::remove(int fd) {
+	int ret = 0;
+
+	pthread_mutex_lock(&this->lock);
+
+	if (epoll_ctl(this->epollfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
+		perror("Reactor: Failed to remove control interface");
+		ret = -1;
+	}
+
+	this->sources.erase(fd);
+
+	// a callback removing its own file descriptor does not wait for itself
+	while (this->active == fd && !pthread_equal(this->dispatcher, pthread_self())) {
+		pthread_cond_wait(&this->finished, &this->lock);
+	}
+
+	pthread_mutex_unlock(&this->lock);
+
+	return ret;
+}
+
+
+int Reactor::run() {
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+	bool running = true;
+
+	while (running) {
+		int nr_events = epoll_wait(this->epollfd, events, REACTOR_MAX_EVENTS, -1);
+
+		if (nr_events < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("Reactor: Poll Wait fail");
+			return -1;
+		}
+
+		for (int i = 0; i < nr_events; i++) {
+			int fd = events[i].data.fd;
+
+			if (fd == this->wakeupfd) {
+				uint64_t value;
+
+				if (::read(this->wakeupfd, &value, sizeof(value)) > 0) {
+					running = false;
+				}
+
+				continue;
+			}
+
+			pthread_mutex_lock(&this->lock);
+
+			// the source may have been removed since epoll_wait returned,
+			// also by a callback of this round
+			map<int, Source>::iterator source = this->sources.find(fd);
+
+			if (source == this->sources.end()) {
+				pthread_mutex_unlock(&this->lock);
+				continue;
+			}
+
+			Source current = source->second;
+
+			this->active = fd;
+			this->dispatcher = pthread_self();
+			pthread_mutex_unlock(&this->lock);
+
+			current.callback(current.arg);
+
+			pthread_mutex_lock(&this->lock);
+			this->active = -1;
+			pthread_cond_broadcast(&this->finished);
+			pthread_mutex_unlock(&this->lock);
+		}
+	}
+
+	return 0;
+}
+
+
+void *threadedReactor(void* arg) {
+	Reactor *reactor = static_cast<Reactor*>(arg);
+
+	reactor->run();
+
+	return 0;
+}
+
+
+int Reactor::start() {
+	if (this->threadRunning) {
+		return 0;
+	}
+
+	if (pthread_create(&this->thread, NULL, threadedReactor, this)) {
+		perror("Reactor: Failed to create the event thread");
+		return -1;
+	}
+
+	this->threadRunning = true;
+
+	return 0;
+}
+
+
+void Reactor::stop() {
+	uint64_t value = 1;
+
+	if (::write(this->wakeupfd, &value, sizeof(value)) < 0) {
+		perror("Reactor: Failed to wake up the event loop");
+	}
+
+	if (this->threadRunning) {
+		pthread_join(this->thread, NULL);
+		this->threadRunning = false;
+	}
+}
+
+} /* namespace BBB */
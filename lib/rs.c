@@ -0,0 +1,249 @@
+/**
+ * @file rs.c
+ * @brief Function implementation for Reed-Solomon error correction
+ * over GF(256).
+ *
+ * Blocks are shortened RS(255, 255 - parity) codewords, data first,
+ * with generator roots alpha^0 .. alpha^(parity - 1).
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date 2020 Feb 08
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "rs.h"
+
+/**
+ * @brief primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+ */
+#define RS_PRIMITIVE	0x11D
+
+
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+static pthread_once_t rsOnce = PTHREAD_ONCE_INIT;
+
+
+static void rs_setup(void) {
+	uint32_t x = 1;
+
+	for (int i = 0; i < 255; i++) {
+		gfExp[i] = x;
+		gfLog[x] = i;
+
+		x <<= 1;
+
+		if (x & 0x100) {
+			x ^= RS_PRIMITIVE;
+		}
+	}
+
+	// doubled so that a product needs no modulo
+	for (int i = 255; i < 512; i++) {
+		gfExp[i] = gfExp[i - 255];
+	}
+}
+
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+	if (a == 0 || b == 0) {
+		return 0;
+	}
+
+	return gfExp[gfLog[a] + gfLog[b]];
+}
+
+
+static inline uint8_t gf_div(uint8_t a, uint8_t b) {
+	if (a == 0) {
+		return 0;
+	}
+
+	return gfExp[gfLog[a] + 255 - gfLog[b]];
+}
+
+
+/**
+ * @brief evaluate a polynomial, lowest coefficient first
+ */
+static uint8_t gf_eval(const uint8_t *poly, int len, uint8_t x) {
+	uint8_t y = 0;
+
+	for (int i = len - 1; i >= 0; i--) {
+		y = gf_mul(y, x) ^ poly[i];
+	}
+
+	return y;
+}
+
+
+int rs_init(rs_codec_t *codec, uint8_t parity) {
+	if (parity == 0 || parity > RS_MAX_PARITY || (parity & 1)) {
+		return -1;
+	}
+
+	pthread_once(&rsOnce, rs_setup);
+
+	// generator = (x - a^0)(x - a^1)...(x - a^(parity-1)), highest coefficient first
+	memset(codec->generator, 0, sizeof(codec->generator));
+	codec->generator[0] = 1;
+	codec->parity = parity;
+
+	for (int i = 0; i < parity; i++) {
+		for (int j = i + 1; j > 0; j--) {
+			codec->generator[j] ^= gf_mul(codec->generator[j - 1], gfExp[i]);
+		}
+	}
+
+	return 0;
+}
+
+
+void rs_encode(const rs_codec_t *codec, const uint8_t *data, uint32_t len, uint8_t *parity) {
+	memset(parity, 0, codec->parity);
+
+	// remainder of data * x^parity divided by the generator
+	for (uint32_t i = 0; i < len; i++) {
+		uint8_t feedback = data[i] ^ parity[0];
+
+		memmove(parity, parity + 1, codec->parity - 1);
+		parity[codec->parity - 1] = 0;
+
+		if (feedback) {
+			uint8_t logFeedback = gfLog[feedback];
+
+			for (int j = 0; j < codec->parity; j++) {
+				if (codec->generator[j + 1]) {
+					parity[j] ^= gfExp[logFeedback + gfLog[codec->generator[j + 1]]];
+				}
+			}
+		}
+	}
+}
+
+
+int rs_decode(const rs_codec_t *codec, uint8_t *block, uint32_t len) {
+	uint8_t syndrome[RS_MAX_PARITY];
+	uint8_t locator[RS_MAX_PARITY + 1];
+	uint8_t previous[RS_MAX_PARITY + 1];
+	uint8_t evaluator[RS_MAX_PARITY];
+	uint8_t position[RS_MAX_PARITY];
+	int parity = codec->parity;
+	int errors = 0;
+	uint8_t nonzero = 0;
+
+	if (len <= (uint32_t)parity || len > RS_MAX_BLOCK) {
+		return -1;
+	}
+
+	// the first byte of the block is the highest power
+	for (int j = 0; j < parity; j++) {
+		uint8_t s = 0;
+
+		for (uint32_t i = 0; i < len; i++) {
+			s = gf_mul(s, gfExp[j]) ^ block[i];
+		}
+
+		syndrome[j] = s;
+		nonzero |= s;
+	}
+
+	if (nonzero == 0) {
+		return 0;
+	}
+
+	// Berlekamp-Massey: error locator polynomial, lowest coefficient first
+	memset(locator, 0, sizeof(locator));
+	memset(previous, 0, sizeof(previous));
+	locator[0] = 1;
+	previous[0] = 1;
+
+	int degree = 0;
+	int shift = 1;
+	uint8_t lastDiscrepancy = 1;
+
+	for (int n = 0; n < parity; n++) {
+		uint8_t d = syndrome[n];
+
+		for (int i = 1; i <= degree; i++) {
+			d ^= gf_mul(locator[i], syndrome[n - i]);
+		}
+
+		if (d == 0) {
+			shift++;
+			continue;
+		}
+
+		uint8_t scale = gf_div(d, lastDiscrepancy);
+		uint8_t saved[RS_MAX_PARITY + 1];
+
+		memcpy(saved, locator, sizeof(saved));
+
+		for (int i = 0; i + shift <= parity; i++) {
+			locator[i + shift] ^= gf_mul(scale, previous[i]);
+		}
+
+		if (2 * degree <= n) {
+			degree = n + 1 - degree;
+			memcpy(previous, saved, sizeof(previous));
+			lastDiscrepancy = d;
+			shift = 1;
+		}
+		else {
+			shift++;
+		}
+	}
+
+	if (2 * degree > parity) {
+		return -1;
+	}
+
+	// Chien search over the positions of a shortened block
+	for (uint32_t i = 0; i < len && errors <= degree; i++) {
+		uint8_t power = len - 1 - i;
+
+		if (gf_eval(locator, degree + 1, gfExp[(255 - power) % 255]) == 0) {
+			if (errors == degree) {
+				return -1;
+			}
+
+			position[errors++] = i;
+		}
+	}
+
+	if (errors != degree) {
+		return -1;
+	}
+
+	// Forney: error values from the evaluator and the derivative of the locator
+	for (int i = 0; i < parity; i++) {
+		uint8_t e = 0;
+
+		for (int j = 0; j <= i && j <= degree; j++) {
+			e ^= gf_mul(syndrome[i - j], locator[j]);
+		}
+
+		evaluator[i] = e;
+	}
+
+	for (int k = 0; k < errors; k++) {
+		uint8_t power = len - 1 - position[k];
+		uint8_t x = gfExp[power];
+		uint8_t xInverse = gfExp[(255 - power) % 255];
+		uint8_t derivative = 0;
+
+		for (int i = 1; i <= degree; i += 2) {
+			derivative ^= gf_mul(locator[i], gfExp[(gfLog[xInverse] * (i - 1)) % 255]);
+		}
+
+		if (derivative == 0) {
+			return -1;
+		}
+
+		block[position[k]] ^= gf_mul(x, gf_div(gf_eval(evaluator, parity, xInverse), derivative));
+	}
+
+	return errors;
+}
@@ -13,8 +13,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
-#include <sys/epoll.h>
-#include <pthread.h>
+#include <sys/ioctl.h>
+#include <poll.h>
 #include "uart.h"
 
 
@@ -22,21 +22,34 @@ using namespace std;
 
 namespace BBB {
 
-UART::UART(UART::PORT port, int baudrate, uint8_t datasize) {
+UART::UART(UART::PORT port, int baudrate, uint8_t datasize, Reactor *reactor) {
 	this->port = port;
 	this->baudrate = baudrate;
 	this->datasize = datasize;
 	this->filename = UART_PATH + to_string(port);
 	this->file = -1;
 
-	this->threadRunning = false;
-	this->callbackFunction = NULL;
+	this->reactor = reactor;
+	this->ownReactor = (reactor == NULL);
+	this->registered = false;
+
+	if (this->ownReactor) {
+		this->reactor = new Reactor;
+	}
 
 	open();
 }
 
 
 UART::~UART() {
+	if (this->registered) {
+		this->reactor->remove(this->file);
+	}
+
+	if (this->ownReactor) {
+		delete this->reactor;
+	}
+
 	if (this->file != -1)
 		close();
 }
@@ -52,7 +65,8 @@ int UART::open() {
 
 	tcgetattr(this->file, &options);
 	options.c_cflag = this->datasize | CREAD | CLOCAL;
-	options.c_iflag = IGNPAR | ICRNL;
+	options.c_iflag = IGNPAR; /**< no input processing either */
+	options.c_oflag = 0; /**< frames are binary, no output processing */
 
 	options.c_lflag &= ~(ECHO | ECHONL | ICANON | IEXTEN | ISIG);
 
@@ -73,24 +87,80 @@ void UART::close() {
 
 
 int UART::send(uint8_t data) {
-	int ret;
+	return sendBuffer(&data, 1);
+}
+
+
+int UART::sendBuffer(const void* buffer, uint32_t len) {
+	const uint8_t* data = (const uint8_t*)buffer;
+	uint32_t sent = 0;
 
-	if ((ret=::write(this->file, &data, 1)) < 0) {
-		perror("UART: Failed to write to the output");
+	while (sent < len) {
+		int ret = ::write(this->file, data + sent, len - sent);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN && waitWritable() == 0) {
+				continue;
+			}
+
+			perror("UART: Failed to write to the output");
+			return -1;
+		}
+
+		sent += ret;
 	}
 
-	return ret;
+	return sent;
 }
 
 
-int UART::sendBuffer(const void* buffer, uint32_t len) {
-	int ret;
+int UART::sendv(const struct iovec* vector, int count) {
+	int total = 0;
+
+	while (count > 0) {
+		int ret = ::writev(this->file, vector, count);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN && waitWritable() == 0) {
+				continue;
+			}
 
-	if ((ret=::write(this->file, buffer, len)) < 0) {
-		perror("UART: Failed to write to the output");
+			perror("UART: Failed to write to the output");
+			return total ? total : -1;
+		}
+
+		total += ret;
+
+		// skip the buffers which are sent completely
+		while (count > 0 && (size_t)ret >= vector->iov_len) {
+			ret -= vector->iov_len;
+			vector++;
+			count--;
+		}
+
+		// finish a partially sent buffer on its own
+		if (ret > 0) {
+			uint32_t rest = vector->iov_len - ret;
+
+			if (sendBuffer((const uint8_t*)vector->iov_base + ret, rest) < 0) {
+				return total;
+			}
+
+			total += rest;
+			vector++;
+			count--;
+		}
 	}
 
-	return ret;
+	return total;
 }
 
 
@@ -117,49 +187,69 @@ int UART::receiveBuffer(void* buffer, uint32_t len) {
 }
 
 
-int UART::waitData() {
-	int nr_events, epollfd;
-	struct epoll_event event;
+uint32_t UART::getCharacterTime() {
+	uint32_t bits;
+	uint32_t rate;
 
-	epollfd = epoll_create1(EPOLL_CLOEXEC);
+	switch (this->datasize) {
+		case CS5: bits = 5; break;
+		case CS6: bits = 6; break;
+		case CS7: bits = 7; break;
+		default: bits = 8; break;
+	}
 
-	if (epollfd < 0) {
-		perror("UART: Failed to create epollfd");
-		return -1;
+	switch (this->baudrate) {
+		case B1200: rate = 1200; break;
+		case B2400: rate = 2400; break;
+		case B4800: rate = 4800; break;
+		case B9600: rate = 9600; break;
+		case B19200: rate = 19200; break;
+		case B38400: rate = 38400; break;
+		case B57600: rate = 57600; break;
+		case B115200: rate = 115200; break;
+		case B230400: rate = 230400; break;
+		case B460800: rate = 460800; break;
+		case B921600: rate = 921600; break;
+		default: rate = 9600; break;
 	}
 
-	event.events = EPOLLIN | EPOLLET | EPOLLPRI;
-	event.data.fd = this->file;
+	// start bit + data bits + stop bit
+	return (uint32_t)(((bits + 2) * 1000000000ULL) / rate);
+}
+
 
-	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, this->file, &event) == -1) {
-		perror("UART: Failed to add control interface");
-		::close(epollfd);
+int UART::getOutputQueue() {
+	int queued;
 
+	if (ioctl(this->file, TIOCOUTQ, &queued) < 0) {
+		perror("UART: Failed to read the output queue");
 		return -1;
 	}
 
+	return queued;
+}
 
-	nr_events = epoll_wait(epollfd, &event, 1, -1);
-
-	if (nr_events == -1) {
-		perror("GPIO: Poll Wait fail");
-		::close(epollfd);
 
+int UART::drain() {
+	if (tcdrain(this->file) < 0) {
+		perror("UART: Failed to drain the output");
 		return -1;
 	}
 
-	::close(epollfd);
-
 	return 0;
 }
 
 
-void *threadedPoll(void* arg) {
-	UART *bus = static_cast<UART*>(arg);
+int UART::waitWritable() {
+	struct pollfd event;
+
+	event.fd = this->file;
+	event.events = POLLOUT;
 
-	while (bus->threadRunning) {
-		if (bus->waitData() == 0) {
-			bus->callbackFunction(bus->callbackArgument);
+	while (poll(&event, 1, -1) < 0) {
+		if (errno != EINTR) {
+			perror("UART: Failed to poll the output");
+			return -1;
 		}
 	}
 
@@ -168,17 +258,24 @@ void *threadedPoll(void* arg) {
 
 
 void UART::onReceiveData(CallbackType callback, void *arg) {
-	this->threadRunning = true;
-	this->callbackFunction = callback;
-	this->callbackArgument = arg;
+	if (this->registered) {
+		this->reactor->remove(this->file);
+		this->registered = false;
+	}
+
+	if (callback == NULL) {
+		return;
+	}
+
+	if (this->reactor->add(this->file, callback, arg) < 0) {
+		perror("UART: Failed to register the device");
+		return;
+	}
 
-	if (pthread_create(&this->thread,
-						NULL,
-						threadedPoll,
-						this)) {
+	this->registered = true;
 
+	if (this->ownReactor && this->reactor->start() < 0) {
 		perror("UART: Failed to create the poll thread");
-		this->threadRunning = false;
 	}
 }
 
@@ -3,6 +3,7 @@
  * @brief Implementations for message protocol using UART.
  *  
  * This file is used to create Data Link Layer for UART Physical Layer.
+ * The classes are header-only, here they are compiled once for UART.
  *
  * @author Nguyen Trong Phuong (aka trongphuongpro)
  * @date January 13, 2020
@@ -10,22 +11,29 @@
 
 
 #include "message.h"
-#include "message.cpp"
+#include "fragment.h"
+#include "dispatcher.h"
+#include "reliable.h"
+#include "awaitable.h"
 #include "uart.h"
 
 using namespace std;
 using namespace BBB;
 
 namespace eLinux {
+inline namespace MESSAGE_CONFIG {
 
 template class MessageBox<UART>;
-
-void ISR(void* arg) {
-	MessageBox<UART> *msg = static_cast<MessageBox<UART>*>(arg);
-
-	if (msg->currentStep < kVerifyingChecksum) {
-		msg->callback[msg->currentStep](msg);
-	}
-}
-
+template class FragmentBox<UART>;
+template class Dispatcher<UART>;
+template class ReliableBox<UART>;
+
+#if defined(__cpp_impl_coroutine)
+template class ReceiveAwaiter<UART>;
+template class MessageAwaiter<UART>;
+template class SendAwaiter<UART>;
+template class AwaitableBox<UART>;
+#endif
+
+} /* namespace MESSAGE_CONFIG */
 } /* namespace eLinux */
\ No newline at end of file
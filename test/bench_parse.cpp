@@ -0,0 +1,221 @@
+/**
+ * @file bench_parse.cpp
+ * @brief Benchmark of the receive path in ns per byte
+ *
+ * A stream of valid frames is recorded once and replayed through
+ * the chunked parser of Message Box and through a copy of the former
+ * byte-at-a-time callback chain, so both run over the same bytes.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "message.h"
+#include "crc32.h"
+#include "replay.h"
+
+using namespace eLinux;
+
+#define STREAM_SIZE		(1 << 16)
+#define ROUNDS			200
+#define SLICE_SIZE		1024
+#define CHAIN_QUEUE_SIZE	64
+
+uint8_t preamble[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+
+
+/**
+ * @brief class Chain is the former parser: one callback per field,
+ * each reading one byte from the device per call
+ */
+class Chain {
+public:
+
+	Chain(Replay& device) : device(device) {
+		this->currentStep = 0;
+		this->head = 0;
+		this->tail = 0;
+		this->callback[0] = parsePreamble;
+		this->callback[1] = parseHeader;
+		this->callback[2] = parsePayload;
+		this->callback[3] = parseChecksum;
+
+		this->device.onReceiveData(onReceive, this);
+	}
+
+	~Chain() {
+		this->device.onReceiveData(NULL, NULL);
+	}
+
+	int pop(Message_t &message) {
+		if (this->head == this->tail) {
+			return -1;
+		}
+
+		message = this->messages[this->tail++ % CHAIN_QUEUE_SIZE];
+
+		return 0;
+	}
+
+private:
+
+	static void onReceive(void *arg) {
+		Chain *chain = static_cast<Chain*>(arg);
+
+		chain->callback[chain->currentStep](chain);
+	}
+
+	static void parsePreamble(void *arg) {
+		Chain *chain = static_cast<Chain*>(arg);
+		static int counter;
+
+		chain->frame[counter] = chain->device.receive();
+
+		if (chain->frame[counter] == preamble[counter]) {
+			counter++;
+		}
+		else {
+			counter = 0;
+		}
+
+		if (counter == MESSAGE_PREAMBLE_SIZE) {
+			counter = 0;
+			chain->currentStep = 1;
+		}
+	}
+
+	static void parseHeader(void *arg) {
+		Chain *chain = static_cast<Chain*>(arg);
+		static int counter = MESSAGE_PREAMBLE_SIZE;
+
+		chain->frame[counter++] = chain->device.receive();
+
+		if (counter == MESSAGE_HEADER_SIZE) {
+			counter = MESSAGE_PREAMBLE_SIZE;
+			memcpy(&chain->payloadSize, chain->frame + MESSAGE_HEADER_SIZE - MESSAGE_SIZE_FIELD_SIZE,
+					MESSAGE_SIZE_FIELD_SIZE);
+
+			if (chain->payloadSize > MESSAGE_MAX_PAYLOAD_SIZE) {
+				chain->payloadSize = MESSAGE_MAX_PAYLOAD_SIZE;
+			}
+
+			chain->currentStep = (chain->payloadSize) ? 2 : 3;
+		}
+	}
+
+	static void parsePayload(void *arg) {
+		Chain *chain = static_cast<Chain*>(arg);
+		static uint32_t counter;
+
+		chain->frame[MESSAGE_HEADER_SIZE + counter++] = chain->device.receive();
+
+		if (counter == chain->payloadSize) {
+			counter = 0;
+			chain->currentStep = 3;
+		}
+	}
+
+	static void parseChecksum(void *arg) {
+		Chain *chain = static_cast<Chain*>(arg);
+		static int counter;
+
+		((uint8_t*)&chain->checksum)[counter++] = chain->device.receive();
+
+		if (counter == sizeof(crc32_t)) {
+			counter = 0;
+
+			if (crc32_compute(chain->frame, MESSAGE_HEADER_SIZE + chain->payloadSize)
+				== chain->checksum) {
+				Message_t &message = chain->messages[chain->head++ % CHAIN_QUEUE_SIZE];
+
+				message.address = chain->frame[MESSAGE_PREAMBLE_SIZE + 1];
+				message.payloadSize = chain->payloadSize;
+				memcpy(message.payload, chain->frame + MESSAGE_HEADER_SIZE, chain->payloadSize);
+			}
+
+			chain->currentStep = 0;
+		}
+	}
+
+	Replay& device;
+	void (*callback[4])(void*);
+	int currentStep;
+	uint8_t frame[MESSAGE_HEADER_SIZE + MESSAGE_MAX_PAYLOAD_SIZE];
+	message_size_t payloadSize;
+	crc32_t checksum;
+	Message_t messages[CHAIN_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+};
+
+
+/**
+ * @brief Replay the recorded stream and pop every message
+ * @param line the recorded stream;
+ * @param box the receiving side.
+ * @return the number of messages.
+ */
+template <class Box>
+uint64_t run(Replay& line, Box& box) {
+	Message_t message;
+	uint64_t count = 0;
+
+	for (int round = 0; round < ROUNDS; round++) {
+		line.rewind();
+
+		while (line.feed(SLICE_SIZE)) {
+			while (box.pop(message) == 0) {
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+
+double elapsed(const struct timespec &start, const struct timespec &stop) {
+	return (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+}
+
+
+int main() {
+	const char *payload = "0123456789abcdefghijklmnopqrstuv";
+	Replay line(STREAM_SIZE);
+	struct timespec start, stop;
+	uint64_t count;
+	int frames = 0;
+
+	{
+		MessageBox<Replay> box(line);
+
+		while (line.size() + MESSAGE_MAX_FRAME_SIZE <= STREAM_SIZE) {
+			box.send(preamble, 1, 2, payload, strlen(payload));
+			frames++;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		count = run(line, box);
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+
+		printf("automaton: %.2f ns/byte, %llu/%llu frames\n",
+				elapsed(start, stop) / ((double)ROUNDS * line.size()),
+				(unsigned long long)count, (unsigned long long)frames * ROUNDS);
+	}
+
+	{
+		Chain chain(line);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		count = run(line, chain);
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+
+		printf("old chain: %.2f ns/byte, %llu/%llu frames\n",
+				elapsed(start, stop) / ((double)ROUNDS * line.size()),
+				(unsigned long long)count, (unsigned long long)frames * ROUNDS);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+/**
+ * @file bench_resync.cpp
+ * @brief Benchmark of the preamble search: frames recovered after line noise,
+ * and bytes and time needed to get back in sync
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "message.h"
+#include "replay.h"
+
+using namespace eLinux;
+
+#define STREAM_SIZE		(1 << 20)
+#define NOISE_SIZE		512
+#define ROUNDS			20
+#define TRIALS			2000
+#define SLICE_SIZE		256
+
+const char *payload = "hello";
+
+
+double elapsed(const struct timespec &start, const struct timespec &stop) {
+	return (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+}
+
+
+uint32_t drain(MessageBox<Replay>& box) {
+	Message_t message;
+	uint32_t count = 0;
+
+	while (box.pop(message) == 0) {
+		count++;
+	}
+
+	return count;
+}
+
+
+/**
+ * @brief Every prefix of the preamble followed by a frame, byte by byte
+ * and in one piece
+ *
+ * A preamble overlapping itself, e.g. aaaaaaaa, is ambiguous after its
+ * own prefix: the earliest match wins and the frame is misread, so not
+ * every frame is recovered with it.
+ */
+void preambles() {
+	const uint8_t preambles[][4] = {{0xAA, 0xBB, 0xCC, 0xDD}, {0xAA, 0xAA, 0xAA, 0xAA},
+									{0xAA, 0xAA, 0xBB, 0xAA}, {0xAB, 0xAB, 0xAB, 0xCD},
+									{0xAA, 0xBB, 0xAA, 0xBB}};
+
+	for (const uint8_t *preamble : preambles) {
+		Replay line(1024);
+		MessageBox<Replay> box(line);
+		uint32_t count = 0, total = 0;
+
+		box.setPreamble(preamble[0], preamble[1], preamble[2], preamble[3]);
+
+		for (uint32_t prefix = 0; prefix < 4; prefix++) {
+			for (uint32_t slice = 0; slice <= 1; slice++) {
+				line.clear();
+				line.inject(preamble, prefix);
+				box.send(preamble, 1, 2, payload, strlen(payload));
+
+				while (line.feed(slice));
+
+				count += drain(box);
+				total++;
+			}
+		}
+
+		printf("preamble %02x%02x%02x%02x: %u/%u frames\n", preamble[0], preamble[1],
+				preamble[2], preamble[3], count, total);
+	}
+}
+
+
+/**
+ * @brief Random noise with frames in between, parsed in driver sized chunks
+ */
+void noise() {
+	uint8_t preamble[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+	uint8_t garbage[NOISE_SIZE];
+	Replay line(STREAM_SIZE);
+	MessageBox<Replay> box(line, 1 << 20);
+	struct timespec start, stop;
+	uint64_t count = 0;
+	uint32_t frames = 0;
+
+	while (line.size() + NOISE_SIZE + MESSAGE_MAX_FRAME_SIZE <= STREAM_SIZE) {
+		uint32_t len = rand() % NOISE_SIZE;
+
+		for (uint32_t i = 0; i < len; i++) {
+			garbage[i] = rand();
+		}
+
+		line.inject(garbage, len);
+		box.send(preamble, 1, 2, payload, strlen(payload));
+		frames++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (int round = 0; round < ROUNDS; round++) {
+		line.rewind();
+
+		while (line.feed(SLICE_SIZE)) {
+			count += drain(box);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	printf("noise: %.2f ns/byte, %llu/%llu frames\n",
+			elapsed(start, stop) / ((double)ROUNDS * line.size()),
+			(unsigned long long)count, (unsigned long long)frames * ROUNDS);
+}
+
+
+/**
+ * @brief Feed a burst of noise, then frames byte by byte until one is received
+ *
+ * A false preamble in the noise swallows the start of the first frame,
+ * the bytes beyond the first frame are the cost of getting back in sync.
+ */
+void resync() {
+	uint8_t preamble[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+	uint8_t garbage[NOISE_SIZE];
+	Replay line(NOISE_SIZE + 8 * MESSAGE_MAX_FRAME_SIZE);
+	MessageBox<Replay> box(line);
+	struct timespec start, stop;
+	uint64_t bytes = 0, lost = 0;
+	uint32_t frame = 0;
+	double time = 0;
+
+	for (int trial = 0; trial < TRIALS; trial++) {
+		uint32_t len = 1 + rand() % NOISE_SIZE;
+		uint32_t received = 0;
+
+		for (uint32_t i = 0; i < len; i++) {
+			garbage[i] = rand();
+		}
+
+		// every other burst ends in a false preamble and part of a header
+		if ((trial & 1) && len > MESSAGE_HEADER_SIZE) {
+			memcpy(garbage + len - 1 - rand() % (MESSAGE_HEADER_SIZE - MESSAGE_PREAMBLE_SIZE)
+					- MESSAGE_PREAMBLE_SIZE, preamble, MESSAGE_PREAMBLE_SIZE);
+		}
+
+		line.clear();
+		line.inject(garbage, len);
+		line.feed();
+		drain(box);
+
+		for (int i = 0; i < 8; i++) {
+			box.send(preamble, 1, 2, payload, strlen(payload));
+		}
+
+		frame = (line.size() - len) / 8;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		while (line.feed(1)) {
+			received++;
+
+			if (drain(box)) {
+				break;
+			}
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+
+		bytes += received;
+		lost += (received - 1) / frame;
+		time += elapsed(start, stop);
+
+		// back to the preamble search for the next trial
+		while (line.feed(SLICE_SIZE));
+		drain(box);
+	}
+
+	printf("resync: %.2f bytes (frame %u bytes), %.0f ns, %llu/%u first frames lost\n",
+			(double)bytes / TRIALS, frame, time / TRIALS, (unsigned long long)lost, TRIALS);
+}
+
+
+int main() {
+	srand(1);
+
+	preambles();
+	noise();
+	resync();
+}
\ No newline at end of file
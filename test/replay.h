@@ -0,0 +1,154 @@
+/**
+ * @file replay.h
+ * @brief Transport recording the frames sent through it and feeding
+ * them back as received data, for benchmarks without a device
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#ifndef __REPLAY__
+#define __REPLAY__
+
+#include <stdint.h>
+#include <string.h>
+#include "transport.h"
+
+
+/**
+ * @brief class Replay is a transport over a memory buffer
+ *
+ * Bytes sent are appended to the buffer, feed() hands the buffer to the
+ * receiving side as if it arrived from the line.
+ */
+class Replay {
+public:
+
+	/**
+	 * @brief Constructor
+	 * @param capacity size of the buffer in byte.
+	 */
+	Replay(uint32_t capacity) {
+		this->data = new uint8_t[capacity];
+		this->capacity = capacity;
+		this->length = 0;
+		this->position = 0;
+		this->callback = NULL;
+		this->arg = NULL;
+	}
+
+	/**
+	 * @brief Destructor
+	 */
+	~Replay() {
+		delete[] this->data;
+	}
+
+	int send(uint8_t byte) {
+		return sendBuffer(&byte, 1);
+	}
+
+	int sendBuffer(const void* buffer, uint32_t len) {
+		if (len > this->capacity - this->length) {
+			return -1;
+		}
+
+		memcpy(this->data + this->length, buffer, len);
+		this->length += len;
+
+		return len;
+	}
+
+	int receive() {
+		return (this->position < this->length) ? this->data[this->position++] : -1;
+	}
+
+	int receiveBuffer(void* buffer, uint32_t len) {
+		uint32_t rest = this->length - this->position;
+
+		if (len > rest) {
+			len = rest;
+		}
+
+		memcpy(buffer, this->data + this->position, len);
+		this->position += len;
+
+		return len;
+	}
+
+	void onReceiveData(eLinux::CallbackType callback, void *arg) {
+		this->callback = callback;
+		this->arg = arg;
+	}
+
+	/**
+	 * @brief Append raw bytes, e.g. line noise
+	 * @param buffer the bytes;
+	 * @param len the number of bytes.
+	 * @return 0: OK, -1: the buffer is full.
+	 */
+	int inject(const void* buffer, uint32_t len) {
+		return (sendBuffer(buffer, len) < 0) ? -1 : 0;
+	}
+
+	/**
+	 * @brief Deliver up to len recorded bytes to the receiving side
+	 * @param len the number of bytes, 0: all the rest.
+	 * @return the number of bytes delivered.
+	 */
+	uint32_t feed(uint32_t len=0) {
+		uint32_t rest = this->length - this->position;
+		uint32_t end = this->length;
+
+		if (len && len < rest) {
+			this->length = this->position + len;
+		}
+
+		uint32_t start = this->position;
+
+		while (this->callback && this->position < this->length) {
+			this->callback(this->arg);
+		}
+
+		this->length = end;
+
+		return this->position - start;
+	}
+
+	/**
+	 * @brief Start feeding from the beginning again
+	 * @return nothing.
+	 */
+	void rewind() {
+		this->position = 0;
+	}
+
+	/**
+	 * @brief Forget the recorded bytes
+	 * @return nothing.
+	 */
+	void clear() {
+		this->length = 0;
+		this->position = 0;
+	}
+
+	/**
+	 * @brief Get the number of recorded bytes
+	 * @return the number of bytes.
+	 */
+	uint32_t size() const {
+		return this->length;
+	}
+
+
+private:
+
+	uint8_t *data; /**< recorded bytes */
+	uint32_t capacity; /**< size of data */
+	uint32_t length; /**< number of recorded bytes */
+	uint32_t position; /**< next byte to deliver */
+	eLinux::CallbackType callback; /**< callback of the receiving side */
+	void *arg; /**< argument of callback */
+};
+
+#endif /* __REPLAY__ */
@@ -23,9 +23,13 @@ int main() {
 	puts("Let's go!");
 
 	while (1) {
-		if (msg.isAvailable()) {
-			msg.pop(packet);
+		for (uint8_t i = 0; i < 4; i++) {
+			printf("Sent %d bytes\n", strlen(s[i]));
+			msg.send(preamble, i, i, s[i], strlen(s[i]));
+		}
 
+		// print incoming messages until the line is quiet for 5 seconds
+		while (msg.pop(packet, 5000) == 0) {
 			printf("[Address] %d\n", packet.address);
 			printf("[Size] %d\n", packet.payloadSize);
 			printf("[Payload] ");
@@ -34,11 +38,5 @@ int main() {
 			}
 			printf("\n----------------------\n");
 		}
-
-		for (uint8_t i = 0; i < 4; i++) {
-			printf("Sent %d bytes\n", strlen(s[i]));
-			msg.send(preamble, i, i, s[i], strlen(s[i]));
-		}
-		sleep(5); /**< very important */
 	}
 }
\ No newline at end of file
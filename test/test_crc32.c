@@ -0,0 +1,177 @@
+/**
+ * @file test_crc32.c
+ * @brief Unit test of the CRC-32 update functions against a bitwise reference
+ *
+ * The translation unit of the library is included, so every update
+ * function is reached, not only the one selected for this CPU.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/crc32.c"
+
+#define TEST_SIZE		4096
+#define TEST_ROUNDS		2000
+
+
+/**
+ * @brief update function under test
+ */
+struct Path {
+	const char *name;
+	crc32_update_t update;
+};
+
+
+static int failures;
+
+
+static void expect(int condition, const char *what, const char *name, uint32_t len) {
+	if (!condition) {
+		printf("FAIL %s: %s, len %u\n", what, name, len);
+		failures++;
+	}
+}
+
+
+/**
+ * @brief one bit at a time, straight from the polynomial
+ */
+static crc32_t crc32_reference(const uint8_t *data, uint32_t len) {
+	crc32_t crc = 0xFFFFFFFF;
+
+	while (len--) {
+		crc ^= *data++;
+
+		for (int i = 0; i < 8; i++) {
+			crc = (crc >> 1) ^ (CRC32POLY_REVERSE & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}
+
+
+static int collect(struct Path *paths) {
+	int count = 0;
+
+	// build the tables before any update function is called directly
+	crc32_updater();
+
+	paths[count].name = "table";
+	paths[count++].update = crc32_update_table;
+	paths[count].name = "slicing-by-8";
+	paths[count++].update = crc32_update_slice8;
+
+#ifdef CRC32_ARMV8
+	if (crc32_have_armv8()) {
+		paths[count].name = "armv8";
+		paths[count++].update = crc32_update_armv8;
+	}
+	else {
+		puts("skip armv8: no crc32 instructions on this CPU");
+	}
+#else
+	puts("skip armv8: not compiled in");
+#endif
+
+#ifdef CRC32_PCLMUL
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		paths[count].name = "pclmul";
+		paths[count++].update = crc32_update_pclmul;
+	}
+	else {
+		puts("skip pclmul: not supported by this CPU");
+	}
+#else
+	puts("skip pclmul: not compiled in");
+#endif
+
+	return count;
+}
+
+
+int main() {
+	static uint8_t data[TEST_SIZE + 16];
+	static uint8_t copy[TEST_SIZE + 16];
+	const char *check = "123456789";
+	struct Path paths[4];
+	int count = collect(paths);
+
+	srand(1);
+
+	for (uint32_t i = 0; i < sizeof(data); i++) {
+		data[i] = rand();
+	}
+
+	expect(crc32_reference((const uint8_t*)check, 9) == 0xCBF43926, "check value", "reference", 9);
+	expect(crc32_compute(check, 9) == 0xCBF43926, "check value", "crc32_compute", 9);
+
+	for (int p = 0; p < count; p++) {
+		expect(~paths[p].update(0xFFFFFFFF, (const uint8_t*)check, 9) == 0xCBF43926,
+				"check value", paths[p].name, 9);
+
+		// every short length at every alignment, then random long ones
+		for (uint32_t len = 0; len <= 300; len++) {
+			for (uint32_t offset = 0; offset < 16; offset++) {
+				expect(~paths[p].update(0xFFFFFFFF, data + offset, len)
+						== crc32_reference(data + offset, len), "update", paths[p].name, len);
+			}
+		}
+
+		for (int round = 0; round < TEST_ROUNDS; round++) {
+			uint32_t offset = rand() % 16;
+			uint32_t len = rand() % (TEST_SIZE + 1);
+
+			expect(~paths[p].update(0xFFFFFFFF, data + offset, len)
+					== crc32_reference(data + offset, len), "update", paths[p].name, len);
+		}
+
+		printf("%s: ok\n", paths[p].name);
+	}
+
+	// a checksum split anywhere must add up to the checksum of the whole
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		uint32_t len = rand() % (TEST_SIZE + 1);
+		uint32_t split = rand() % (len + 1);
+		crc32_t whole = crc32_reference(data, len);
+		crc32_t head = crc32_compute(data, split);
+
+		expect(crc32_concat(head, data + split, len - split) == whole, "crc32_concat", "", len);
+		expect(crc32_combine(head, crc32_compute(data + split, len - split), len - split) == whole,
+				"crc32_combine", "", len);
+
+		memset(copy, 0, sizeof(copy));
+		expect(crc32_copy(head, copy + split, data + split, len - split) == whole,
+				"crc32_copy", "", len);
+		expect(memcmp(copy + split, data + split, len - split) == 0, "crc32_copy data", "", len);
+	}
+
+	puts("combine, concat, copy: ok");
+
+	// data followed by its inverted checksum passes, a single flipped bit does not
+	uint32_t len = 100;
+	crc32_t crc = crc32_compute(data, len);
+	crc32_t residue = ~crc;
+
+	memcpy(copy, data, len);
+	memcpy(copy + len, &residue, 4);
+	expect(crc32_check(copy, len + 4) == 0, "crc32_check", "", len);
+	expect(crc32_selfcheck(data, len, crc) == 0, "crc32_selfcheck", "", len);
+	copy[rand() % len] ^= 1 << (rand() % 8);
+	expect(crc32_check(copy, len + 4) != 0, "crc32_check flipped bit", "", len);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	puts("crc32: ok");
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+ * @file test_lz.c
+ * @brief Unit test of LZ compression round trips and of decompression
+ * of malformed input
+ *
+ * A corrupted or hostile payload must be rejected, or decompressed
+ * without writing beyond the output capacity.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lz.h"
+
+#define TEST_SIZE		300
+#define TEST_ROUNDS		100000
+#define GUARD_SIZE		64
+#define GUARD			0xA5
+
+
+static int failures;
+
+static const char *text = "message number payload number temperature=23.5C humidity=45% "
+						"Hello from BeagleBone Black";
+
+
+static void expect(int condition, const char *what, int round) {
+	if (!condition) {
+		printf("FAIL %s, round %d\n", what, round);
+		failures++;
+	}
+}
+
+
+/**
+ * @brief Decompress into a buffer followed by guard bytes
+ * @return result of lz_decompress, -2: the guard bytes were overwritten.
+ */
+static int32_t decompress(const lz_dictionary_t *dictionary, const uint8_t *src, uint32_t len,
+							uint32_t capacity)
+{
+	static uint8_t out[TEST_SIZE + GUARD_SIZE];
+	int32_t result;
+
+	memset(out, GUARD, sizeof(out));
+	result = lz_decompress(dictionary, src, len, out, capacity);
+
+	for (uint32_t i = capacity; i < capacity + GUARD_SIZE; i++) {
+		if (out[i] != GUARD) {
+			return -2;
+		}
+	}
+
+	return result;
+}
+
+
+static void roundTrips(const lz_dictionary_t *dictionary) {
+	uint8_t data[TEST_SIZE], packed[2 * TEST_SIZE], unpacked[TEST_SIZE];
+
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		const lz_dictionary_t *shared = (round & 1) ? dictionary : NULL;
+		uint32_t len = rand() % (TEST_SIZE + 1);
+		int kind = rand() % 3;
+
+		// incompressible, repetitive, and close to the dictionary
+		for (uint32_t i = 0; i < len; i++) {
+			data[i] = (kind == 0) ? rand() : (kind == 1) ? "abcab"[rand() % 5]
+					: text[(i + round) % strlen(text)];
+		}
+
+		uint32_t n = lz_compress(shared, data, len, packed, sizeof(packed));
+
+		expect(n > 0 || len == 0, "compress", round);
+		expect(lz_decompress(shared, packed, n, unpacked, len) == (int32_t)len, "decompress", round);
+		expect(memcmp(data, unpacked, len) == 0, "round trip", round);
+
+		// an output too small is reported, not overrun
+		if (len > 0) {
+			expect(lz_compress(shared, data, len, packed, n - 1) == 0, "compress capacity", round);
+			expect(decompress(shared, packed, n, len - 1) == -1, "decompress capacity", round);
+		}
+
+		// every corruption is rejected or stays within capacity
+		uint8_t saved[2 * TEST_SIZE];
+
+		memcpy(saved, packed, n);
+
+		for (int k = 0; k < 4 && n > 0; k++) {
+			packed[rand() % n] ^= 1 << (rand() % 8);
+			expect(decompress(shared, packed, n, len) >= -1, "corrupted input overrun", round);
+		}
+
+		// and so is every truncation
+		for (uint32_t cut = 0; cut < n; cut += 1 + cut / 4) {
+			int32_t result = decompress(shared, saved, cut, len);
+
+			expect(result >= -1 && result <= (int32_t)len, "truncated input", round);
+		}
+	}
+}
+
+
+static void garbage(const lz_dictionary_t *dictionary) {
+	uint8_t input[TEST_SIZE];
+
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		uint32_t len = rand() % (TEST_SIZE + 1);
+		uint32_t capacity = rand() % (TEST_SIZE + 1);
+
+		for (uint32_t i = 0; i < len; i++) {
+			input[i] = rand();
+		}
+
+		int32_t result = decompress((round & 1) ? dictionary : NULL, input, len, capacity);
+
+		expect(result >= -1 && result <= (int32_t)capacity, "random input", round);
+	}
+}
+
+
+static void malformed(const lz_dictionary_t *dictionary) {
+	uint8_t run[100], packed[2 * sizeof(run)];
+
+	// token: literal count << 4 | match length - 4, then literals and a 2-byte offset
+	const uint8_t zeroOffset[] = {0x10, 'a', 0x00, 0x00};
+	const uint8_t farOffset[] = {0x10, 'a', 0x02, 0x00};
+	const uint8_t shortLiterals[] = {0x50, 'a'};
+	const uint8_t openCount[] = {0xF0, 0xFF};
+	const uint8_t openMatch[] = {0x1F, 'a', 0x01, 0x00, 0xFF};
+	const uint8_t halfOffset[] = {0x11, 'a', 0x01};
+	const uint8_t inDictionary[] = {0x10, 'a', 0x06, 0x00};
+	const uint8_t pastDictionary[] = {0x10, 'a', 0x07, 0x00};
+	lz_dictionary_t small;
+
+	expect(decompress(NULL, zeroOffset, sizeof(zeroOffset), TEST_SIZE) == -1, "zero offset", 0);
+	expect(decompress(NULL, farOffset, sizeof(farOffset), TEST_SIZE) == -1, "offset before output", 0);
+	expect(decompress(NULL, shortLiterals, sizeof(shortLiterals), TEST_SIZE) == -1,
+			"literals beyond input", 0);
+	expect(decompress(NULL, openCount, sizeof(openCount), TEST_SIZE) == -1, "open literal count", 0);
+	expect(decompress(NULL, openMatch, sizeof(openMatch), TEST_SIZE) == -1, "open match length", 0);
+	expect(decompress(NULL, halfOffset, sizeof(halfOffset), TEST_SIZE) == -1, "half offset", 0);
+	expect(decompress(NULL, NULL, 0, TEST_SIZE) == 0, "empty input", 0);
+
+	// the history is the dictionary followed by the output
+	lz_dictionary(&small, "hello", 5);
+	expect(decompress(&small, inDictionary, sizeof(inDictionary), TEST_SIZE) == 5,
+			"offset into dictionary", 0);
+	expect(decompress(&small, pastDictionary, sizeof(pastDictionary), TEST_SIZE) == -1,
+			"offset before dictionary", 0);
+	expect(decompress(dictionary, pastDictionary, sizeof(pastDictionary), TEST_SIZE) == 5,
+			"offset into long dictionary", 0);
+
+	// a long match must fit into capacity
+	memset(run, 'a', sizeof(run));
+	uint32_t n = lz_compress(NULL, run, sizeof(run), packed, sizeof(packed));
+
+	expect(n > 0 && n < sizeof(run), "compress run", 0);
+	expect(decompress(NULL, packed, n, sizeof(run)) == sizeof(run), "decompress run", 0);
+	expect(decompress(NULL, packed, n, sizeof(run) / 2) == -1, "run beyond capacity", 0);
+}
+
+
+int main() {
+	static lz_dictionary_t dictionary;
+
+	srand(1);
+	lz_dictionary(&dictionary, text, strlen(text));
+
+	roundTrips(&dictionary);
+	garbage(&dictionary);
+	malformed(&dictionary);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	puts("lz: ok");
+
+	return 0;
+}
\ No newline at end of file
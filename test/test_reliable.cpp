@@ -0,0 +1,384 @@
+/**
+ * @file test_reliable.cpp
+ * @brief Unit test of ReliableBox over a lossy link
+ *
+ * Two nodes are connected by pipes. Frames may be dropped on the way,
+ * every message must still be popped once and in order.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "message.h"
+#include "reliable.h"
+
+using namespace eLinux;
+
+uint8_t preamble[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+
+
+/**
+ * @brief class Link is one end of a link, each frame is written to the pipe
+ * of the other end unless it is dropped
+ */
+class Link {
+public:
+
+	Link() {
+		this->peer = NULL;
+		this->callback = NULL;
+		this->arg = NULL;
+		this->lossRate = 0;
+		this->syncLoss = 0;
+		this->dropped = 0;
+		this->seed = 1;
+
+		if (pipe(this->rx) < 0) {
+			perror("Link: Failed to create pipe");
+		}
+
+		fcntl(this->rx[0], F_SETFL, O_NONBLOCK);
+		fcntl(this->rx[0], F_SETPIPE_SZ, 1 << 20);
+		pthread_mutex_init(&this->lock, NULL);
+	}
+
+	~Link() {
+		::close(this->rx[0]);
+		::close(this->rx[1]);
+		pthread_mutex_destroy(&this->lock);
+	}
+
+	void connect(Link &other) {
+		this->peer = &other;
+		other.peer = this;
+	}
+
+	int sendv(const struct iovec* vector, int count) {
+		uint8_t frame[2 * MESSAGE_MAX_FRAME_SIZE];
+		uint32_t len = 0;
+
+		for (int i = 0; i < count; i++) {
+			memcpy(frame + len, vector[i].iov_base, vector[i].iov_len);
+			len += vector[i].iov_len;
+		}
+
+		if (drop(frame)) {
+			return len;
+		}
+
+		if (::write(this->peer->rx[1], frame, len) < 0) {
+			return -1;
+		}
+
+		pthread_mutex_lock(&this->peer->lock);
+
+		if (this->peer->callback) {
+			this->peer->callback(this->peer->arg);
+		}
+
+		pthread_mutex_unlock(&this->peer->lock);
+
+		return len;
+	}
+
+	int sendBuffer(const void* buffer, uint32_t len) {
+		struct iovec vector = {(void*)buffer, len};
+
+		return sendv(&vector, 1);
+	}
+
+	int send(uint8_t byte) {
+		return sendBuffer(&byte, 1);
+	}
+
+	int receive() {
+		uint8_t byte;
+
+		return (::read(this->rx[0], &byte, 1) == 1) ? byte : -1;
+	}
+
+	int receiveBuffer(void* buffer, uint32_t len) {
+		return ::read(this->rx[0], buffer, len);
+	}
+
+	void onReceiveData(CallbackType callback, void *arg) {
+		pthread_mutex_lock(&this->lock);
+		this->callback = callback;
+		this->arg = arg;
+		pthread_mutex_unlock(&this->lock);
+	}
+
+	uint32_t lossRate; /**< percentage of frames dropped */
+	uint32_t syncLoss; /**< number of SYNC data frames still to drop */
+	uint32_t dropped; /**< number of frames dropped */
+
+private:
+
+	bool drop(const uint8_t *frame) {
+		uint8_t control = frame[MESSAGE_HEADER_SIZE];
+		bool lost = false;
+
+		// the reliable header follows the frame header
+		if (this->syncLoss && (control & RELIABLE_DATA) && (control & RELIABLE_SYNC)) {
+			this->syncLoss--;
+			lost = true;
+		}
+		else if (this->lossRate && (uint32_t)rand_r(&this->seed) % 100 < this->lossRate) {
+			lost = true;
+		}
+
+		this->dropped += lost;
+
+		return lost;
+	}
+
+	Link *peer; /**< the other end */
+	int rx[2]; /**< pipe of received bytes */
+	CallbackType callback; /**< callback of the receiving Message Box */
+	void *arg; /**< argument of callback */
+	pthread_mutex_t lock; /**< protects callback */
+	unsigned int seed; /**< state of the loss generator */
+};
+
+
+static int failures;
+
+
+/**
+ * @brief Compare a message of the random loss test
+ * @param message the popped message;
+ * @param index its expected number.
+ * @return nothing.
+ */
+static void check(const Message_t &message, int index) {
+	char expected[16];
+
+	snprintf(expected, sizeof(expected), "msg %d", index);
+
+	if (message.payloadSize != strlen(expected) + 1 || strcmp((char*)message.payload, expected)) {
+		printf("FAIL got %.*s, expected %s\n", message.payloadSize, message.payload, expected);
+		failures++;
+	}
+}
+
+
+/**
+ * @brief Pop a message and compare it
+ * @param box the receiving side;
+ * @param expected the expected message.
+ * @return nothing.
+ */
+static void expect(ReliableBox<Link> &box, const char *expected) {
+	Message_t message;
+
+	if (box.pop(message, 5000) < 0) {
+		printf("FAIL missing %s\n", expected);
+		failures++;
+	}
+	else if (message.payloadSize != strlen(expected) + 1 || strcmp((char*)message.payload, expected)) {
+		printf("FAIL got %.*s, expected %s\n", message.payloadSize, message.payload, expected);
+		failures++;
+	}
+}
+
+
+/**
+ * @brief No message may follow
+ * @param box the receiving side.
+ * @return nothing.
+ */
+static void expectNothing(ReliableBox<Link> &box) {
+	Message_t message;
+
+	if (box.pop(message, 300) == 0) {
+		printf("FAIL extra %.*s\n", message.payloadSize, message.payload);
+		failures++;
+	}
+}
+
+
+static void send(ReliableBox<Link> &box, const char *message) {
+	if (box.send(2, message, strlen(message) + 1, 5000) < 0) {
+		printf("FAIL send %s\n", message);
+		failures++;
+	}
+}
+
+
+static void report(const char *name, int before) {
+	printf("%s: %s\n", name, (failures == before) ? "ok" : "FAIL");
+}
+
+
+/**
+ * @brief The first message of a sequence is lost once, then twice, so its
+ * retransmission arrives after the following messages
+ */
+static void syncLoss() {
+	for (uint32_t loss = 1; loss <= 2; loss++) {
+		Link a, b;
+		int before = failures;
+		char text[8];
+
+		a.connect(b);
+		a.syncLoss = loss;
+
+		MessageBox<Link> boxA(a), boxB(b);
+		ReliableBox<Link> sender(boxA, preamble, 1, 8, 50), receiver(boxB, preamble, 2, 8, 50);
+
+		for (int i = 0; i < 6; i++) {
+			snprintf(text, sizeof(text), "%c", 'a' + i);
+			send(sender, text);
+		}
+
+		for (int i = 0; i < 6; i++) {
+			snprintf(text, sizeof(text), "%c", 'a' + i);
+			expect(receiver, text);
+		}
+
+		expectNothing(receiver);
+		report((loss == 1) ? "lost SYNC" : "lost SYNC twice", before);
+	}
+}
+
+
+/**
+ * @brief The receiver restarts between two sequences
+ */
+static void receiverRestart() {
+	Link a, b;
+	int before = failures;
+
+	a.connect(b);
+
+	MessageBox<Link> boxA(a), boxB(b);
+	ReliableBox<Link> sender(boxA, preamble, 1, 8, 50);
+
+	{
+		ReliableBox<Link> receiver(boxB, preamble, 2, 8, 50);
+
+		send(sender, "1");
+		send(sender, "2");
+		expect(receiver, "1");
+		expect(receiver, "2");
+		usleep(100000);
+	}
+
+	{
+		ReliableBox<Link> receiver(boxB, preamble, 2, 8, 50);
+
+		send(sender, "3");
+		send(sender, "4");
+		expect(receiver, "3");
+		expect(receiver, "4");
+	}
+
+	report("receiver restart", before);
+}
+
+
+/**
+ * @brief The sender restarts over and over, at another sequence number each time
+ */
+static void senderRestart() {
+	Link a, b;
+	int before = failures;
+	char text[16];
+
+	a.connect(b);
+
+	MessageBox<Link> boxA(a), boxB(b);
+	ReliableBox<Link> receiver(boxB, preamble, 2, 8, 50);
+
+	for (int round = 0; round < 30; round++) {
+		ReliableBox<Link> sender(boxA, preamble, 1, 8, 50);
+
+		for (int i = 0; i < 3; i++) {
+			snprintf(text, sizeof(text), "%d.%d", round, i);
+			send(sender, text);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			snprintf(text, sizeof(text), "%d.%d", round, i);
+			expect(receiver, text);
+		}
+
+		usleep(20000 + (round * 7919) % 1000);
+	}
+
+	report("sender restarts", before);
+}
+
+
+/**
+ * @brief Frames are dropped at random in both directions, the receiver
+ * pops while the sender sends
+ */
+static void randomLoss() {
+	Link a, b;
+	int before = failures;
+	int received = 0;
+	Message_t message;
+	char text[16];
+
+	a.connect(b);
+	a.lossRate = 20;
+	b.lossRate = 20;
+
+	MessageBox<Link> boxA(a), boxB(b);
+	ReliableBox<Link> sender(boxA, preamble, 1, 16, 20), receiver(boxB, preamble, 2, 16, 20);
+
+	for (int i = 0; i < 1000; i++) {
+		snprintf(text, sizeof(text), "msg %d", i);
+		send(sender, text);
+
+		while (receiver.pop(message, 0) == 0) {
+			check(message, received++);
+		}
+	}
+
+	while (received < 1000 && receiver.pop(message, 5000) == 0) {
+		check(message, received++);
+	}
+
+	if (received != 1000) {
+		printf("FAIL %d/1000 messages\n", received);
+		failures++;
+	}
+
+	expectNothing(receiver);
+
+	if (sender.getFailures()) {
+		printf("FAIL %u messages given up\n", sender.getFailures());
+		failures++;
+	}
+
+	printf("random loss: %u+%u frames dropped, %u retransmitted\n", a.dropped, b.dropped,
+			sender.getRetransmissions());
+	report("random loss", before);
+}
+
+
+int main() {
+	syncLoss();
+	receiverRestart();
+	senderRestart();
+	randomLoss();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	puts("reliable: ok");
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+/**
+ * @file test_rs.c
+ * @brief Unit test of Reed-Solomon encoding and decoding round trips
+ *
+ * Every block must come back with up to parity/2 bytes corrupted.
+ * With one error more, the decoder must not claim the original block.
+ *
+ * @author Nguyen Trong Phuong (aka trongphuongpro)
+ * @date February 16, 2020
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rs.h"
+
+#define TEST_ROUNDS		1000
+
+
+static int failures;
+
+
+static void expect(int condition, const char *what, int parity, int len, int errors) {
+	if (!condition) {
+		printf("FAIL %s: parity %d, len %d, %d errors\n", what, parity, len, errors);
+		failures++;
+	}
+}
+
+
+/**
+ * @brief Corrupt bytes at distinct positions
+ * @param block the block;
+ * @param len length of block;
+ * @param errors number of bytes to corrupt.
+ * @return nothing.
+ */
+static void corrupt(uint8_t *block, int len, int errors) {
+	uint8_t hit[RS_MAX_BLOCK] = {0};
+
+	while (errors) {
+		int position = rand() % len;
+
+		if (!hit[position]) {
+			hit[position] = 1;
+			block[position] ^= 1 + rand() % 255;
+			errors--;
+		}
+	}
+}
+
+
+int main() {
+	uint8_t block[RS_MAX_BLOCK], original[RS_MAX_BLOCK];
+	int detected = 0, miscorrected = 0;
+	rs_codec_t codec;
+
+	srand(1);
+
+	expect(rs_init(&codec, 0) < 0, "parity 0 accepted", 0, 0, 0);
+	expect(rs_init(&codec, 3) < 0, "odd parity accepted", 3, 0, 0);
+	expect(rs_init(&codec, RS_MAX_PARITY + 2) < 0, "parity too large accepted", RS_MAX_PARITY + 2, 0, 0);
+
+	for (int parity = 2; parity <= RS_MAX_PARITY; parity += 2) {
+		expect(rs_init(&codec, parity) == 0, "rs_init", parity, 0, 0);
+
+		for (int round = 0; round < TEST_ROUNDS; round++) {
+			// short blocks, as for a frame header, and full ones
+			int len = (round & 1) ? RS_MAX_BLOCK - parity : 1 + rand() % (RS_MAX_BLOCK - parity);
+			int n = len + parity;
+			int errors = rand() % (parity / 2 + 1);
+
+			for (int i = 0; i < len; i++) {
+				block[i] = rand();
+			}
+
+			rs_encode(&codec, block, len, block + len);
+			memcpy(original, block, n);
+
+			expect(rs_decode(&codec, block, n) == 0, "clean block", parity, len, 0);
+
+			corrupt(block, n, errors);
+			expect(rs_decode(&codec, block, n) == errors, "number of corrected bytes", parity, len, errors);
+			expect(memcmp(block, original, n) == 0, "corrected block", parity, len, errors);
+
+			// beyond the capacity: failure, or another codeword, never the original
+			memcpy(block, original, n);
+			corrupt(block, n, parity / 2 + 1);
+
+			if (rs_decode(&codec, block, n) < 0) {
+				detected++;
+			}
+			else {
+				expect(memcmp(block, original, n) != 0, "original from too many errors",
+						parity, len, parity / 2 + 1);
+				expect(rs_decode(&codec, block, n) == 0, "miscorrection is a codeword",
+						parity, len, parity / 2 + 1);
+				miscorrected++;
+			}
+		}
+	}
+
+	printf("parity/2 + 1 errors: %d detected, %d miscorrected\n", detected, miscorrected);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	puts("rs: ok");
+
+	return 0;
+}
\ No newline at end of file